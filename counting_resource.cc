@@ -0,0 +1,47 @@
+#include <cstddef>
+#include <memory_resource>
+
+#include "counting_resource.h"
+
+smo::CountingMemoryResource::CountingMemoryResource()
+    : CountingMemoryResource(std::pmr::get_default_resource()) {}
+
+smo::CountingMemoryResource::CountingMemoryResource(
+    std::pmr::memory_resource* upstream)
+    : upstream_(upstream) {}
+
+std::pmr::memory_resource* smo::CountingMemoryResource::upstream_resource()
+    const {
+  return upstream_;
+}
+std::size_t smo::CountingMemoryResource::allocations() const {
+  return allocations_;
+}
+std::size_t smo::CountingMemoryResource::deallocations() const {
+  return deallocations_;
+}
+std::size_t smo::CountingMemoryResource::bytes_in_use() const {
+  return bytes_in_use_;
+}
+
+void* smo::CountingMemoryResource::do_allocate(std::size_t bytes,
+                                               std::size_t alignment) {
+  auto* pointer = upstream_->allocate(bytes, alignment);
+  allocations_ += 1;
+  bytes_in_use_ += bytes;
+  return pointer;
+}
+
+void smo::CountingMemoryResource::do_deallocate(void* pointer,
+                                                std::size_t bytes,
+                                                std::size_t alignment) {
+  upstream_->deallocate(pointer, bytes, alignment);
+  deallocations_ += 1;
+  bytes_in_use_ -= bytes;
+}
+
+// Memory can be freed through another resource only if it's the same one.
+bool smo::CountingMemoryResource::do_is_equal(
+    const std::pmr::memory_resource& other) const noexcept {
+  return this == &other;
+}
@@ -0,0 +1,35 @@
+#ifndef COUNTING_RESOURCE_H_
+#define COUNTING_RESOURCE_H_
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace smo {
+// Passes every request to the upstream resource and counts them, so that
+// allocations of a simulator can be checked, e.g. to be zero per event once
+// it runs in steady state. Not thread-safe, like the std pool resources.
+class CountingMemoryResource : public std::pmr::memory_resource {
+ public:
+  CountingMemoryResource();
+  explicit CountingMemoryResource(std::pmr::memory_resource* upstream);
+
+  std::pmr::memory_resource* upstream_resource() const;
+  std::size_t allocations() const;
+  std::size_t deallocations() const;
+  // Allocated and not yet deallocated.
+  std::size_t bytes_in_use() const;
+
+ private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void* pointer, std::size_t bytes,
+                     std::size_t alignment) override;
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override;
+
+  std::pmr::memory_resource* upstream_;
+  std::size_t allocations_ = 0;
+  std::size_t deallocations_ = 0;
+  std::size_t bytes_in_use_ = 0;
+};
+}  // namespace smo
+#endif
@@ -9,7 +9,7 @@
 
 using OptionalArgumentsMap = std::map<std::string, std::function<void()>>;
 static void RemoveModeFlags(OptionalArgumentsMap& oam) {
-  for (auto&& flag : {"-i", "-a"}) {
+  for (auto&& flag : {"-i", "-a", "-b", "-O", "-L", "-D", "-N"}) {
     oam.erase(flag);
   }
 }
@@ -26,17 +26,118 @@ codes::Result parse::Arguments::Parse(int argc, char** argv) {
     mode = SimulationMode::automatic;
     RemoveModeFlags(optional_arguments);
   };
+  optional_arguments["-b"] = [&] {
+    mode = SimulationMode::benchmark;
+    std::size_t next_argument_index = current_argument_index + 1;
+    if (next_argument_index <= last_argument_index) {
+      auto next_argument = argv[next_argument_index];
+      try {
+        benchmark_cycles = std::stoul(next_argument);
+        current_argument_index = next_argument_index;
+      } catch (...) {
+        result = codes::invalidArguments;
+      }
+      if (benchmark_cycles == 0) {
+        result = codes::invalidArguments;
+      }
+    } else {
+      result = codes::invalidArguments;
+    }
+    RemoveModeFlags(optional_arguments);
+  };
+  optional_arguments["-O"] = [&] {
+    mode = SimulationMode::capacitySearch;
+    std::size_t last_value_index = current_argument_index + 2;
+    if (last_value_index <= last_argument_index) {
+      try {
+        max_rejection_probability = std::stod(argv[last_value_index - 1]);
+        max_wait = std::stoull(argv[last_value_index]);
+        current_argument_index = last_value_index;
+      } catch (...) {
+        result = codes::invalidArguments;
+      }
+    } else {
+      result = codes::invalidArguments;
+    }
+    RemoveModeFlags(optional_arguments);
+  };
+  optional_arguments["-L"] = [&] {
+    mode = SimulationMode::lockstepBenchmark;
+    std::size_t next_argument_index = current_argument_index + 1;
+    if (next_argument_index <= last_argument_index) {
+      auto next_argument = argv[next_argument_index];
+      try {
+        lanes = std::stoul(next_argument);
+        current_argument_index = next_argument_index;
+      } catch (...) {
+        result = codes::invalidArguments;
+      }
+      if (lanes == 0) {
+        result = codes::invalidArguments;
+      }
+    } else {
+      result = codes::invalidArguments;
+    }
+    RemoveModeFlags(optional_arguments);
+  };
+  optional_arguments["-D"] = [&] {
+    mode = SimulationMode::differentialTesting;
+    std::size_t next_argument_index = current_argument_index + 1;
+    if (next_argument_index <= last_argument_index) {
+      auto next_argument = argv[next_argument_index];
+      try {
+        differential_cases = std::stoul(next_argument);
+        current_argument_index = next_argument_index;
+      } catch (...) {
+        result = codes::invalidArguments;
+      }
+    } else {
+      result = codes::invalidArguments;
+    }
+    RemoveModeFlags(optional_arguments);
+  };
+  optional_arguments["-N"] = [&] {
+    mode = SimulationMode::networkCheck;
+    std::size_t next_argument_index = current_argument_index + 1;
+    if (next_argument_index <= last_argument_index) {
+      auto next_argument = argv[next_argument_index];
+      try {
+        network_stations = std::stoul(next_argument);
+        current_argument_index = next_argument_index;
+      } catch (...) {
+        result = codes::invalidArguments;
+      }
+      if (network_stations == 0) {
+        result = codes::invalidArguments;
+      }
+    } else {
+      result = codes::invalidArguments;
+    }
+    RemoveModeFlags(optional_arguments);
+  };
   optional_arguments["-d"] = [&] {
     law = smo::SimulatorLaw::deterministic;
     optional_arguments.erase("-d");
   };
+  optional_arguments["-g"] = [&] {
+    device_grouping = smo::DeviceGrouping::aggregated;
+    optional_arguments.erase("-g");
+  };
+  optional_arguments["-G"] = [&] {
+    estimate_gradients = true;
+    optional_arguments.erase("-G");
+  };
+  optional_arguments["-p"] = [&] {
+    show_progress = true;
+    optional_arguments.erase("-p");
+  };
   optional_arguments["-o"] = [&] {
     need_output = true;
     std::size_t next_argument_index = current_argument_index + 1;
     if (next_argument_index <= last_argument_index) {
       auto next_argument = argv[next_argument_index];
       if (optional_arguments.count(next_argument) == 0) {
-        report_file = std::ofstream(next_argument);
+        report_file = std::ofstream(next_argument, std::ios::binary);
         if (!report_file) {
           result = codes::outputFileError;
         }
@@ -45,6 +146,20 @@ codes::Result parse::Arguments::Parse(int argc, char** argv) {
     }
     optional_arguments.erase("-o");
   };
+  optional_arguments["-c"] = [&] {
+    std::size_t next_argument_index = current_argument_index + 1;
+    if (next_argument_index <= last_argument_index) {
+      binary_config_file =
+          std::ofstream(argv[next_argument_index], std::ios::binary);
+      if (!*binary_config_file) {
+        result = codes::outputFileError;
+      }
+      current_argument_index = next_argument_index;
+    } else {
+      result = codes::invalidArguments;
+    }
+    optional_arguments.erase("-c");
+  };
   optional_arguments["-m"] = [&] {
     std::size_t next_argument_index = current_argument_index + 1;
     if (next_argument_index <= last_argument_index) {
@@ -60,6 +175,110 @@ codes::Result parse::Arguments::Parse(int argc, char** argv) {
     }
     optional_arguments.erase("-m");
   };
+  optional_arguments["-f"] = [&] {
+    const std::map<std::string, ReportFormat> formats{
+        {"table", ReportFormat::table},
+        {"csv", ReportFormat::csv},
+        {"jsonl", ReportFormat::jsonLines},
+        {"binary", ReportFormat::binary},
+    };
+    std::size_t next_argument_index = current_argument_index + 1;
+    if (next_argument_index <= last_argument_index) {
+      auto format = formats.find(argv[next_argument_index]);
+      if (format != formats.end()) {
+        report_format = format->second;
+        current_argument_index = next_argument_index;
+      } else {
+        result = codes::invalidArguments;
+      }
+    } else {
+      result = codes::invalidArguments;
+    }
+    optional_arguments.erase("-f");
+  };
+  optional_arguments["-s"] = [&] {
+    const std::map<std::string, smo::SourceArrivals> arrivals{
+        {"periodic", smo::SourceArrivals::periodic},
+        {"poisson", smo::SourceArrivals::poisson},
+        {"merged", smo::SourceArrivals::mergedPoisson},
+    };
+    std::size_t next_argument_index = current_argument_index + 1;
+    if (next_argument_index <= last_argument_index) {
+      auto arrival = arrivals.find(argv[next_argument_index]);
+      if (arrival != arrivals.end()) {
+        source_arrivals = arrival->second;
+        current_argument_index = next_argument_index;
+      } else {
+        result = codes::invalidArguments;
+      }
+    } else {
+      result = codes::invalidArguments;
+    }
+    optional_arguments.erase("-s");
+  };
+  optional_arguments["-A"] = [&] {
+    std::size_t next_argument_index = current_argument_index + 1;
+    if (next_argument_index <= last_argument_index) {
+      arrival_trace_path = argv[next_argument_index];
+      current_argument_index = next_argument_index;
+    } else {
+      result = codes::invalidArguments;
+    }
+    optional_arguments.erase("-A");
+  };
+  optional_arguments["-S"] = [&] {
+    std::size_t next_argument_index = current_argument_index + 1;
+    if (next_argument_index <= last_argument_index) {
+      service_trace_path = argv[next_argument_index];
+      current_argument_index = next_argument_index;
+    } else {
+      result = codes::invalidArguments;
+    }
+    optional_arguments.erase("-S");
+  };
+  optional_arguments["-r"] = [&] {
+    std::size_t next_argument_index = current_argument_index + 1;
+    if (next_argument_index <= last_argument_index) {
+      auto next_argument = argv[next_argument_index];
+      try {
+        seed = std::stoull(next_argument);
+        current_argument_index = next_argument_index;
+      } catch (...) {
+        result = codes::invalidArguments;
+      }
+    } else {
+      result = codes::invalidArguments;
+    }
+    optional_arguments.erase("-r");
+  };
+  optional_arguments["-R"] = [&] {
+    std::size_t next_argument_index = current_argument_index + 1;
+    if (next_argument_index <= last_argument_index) {
+      auto next_argument = argv[next_argument_index];
+      try {
+        replications = std::stoul(next_argument);
+        current_argument_index = next_argument_index;
+      } catch (...) {
+        result = codes::invalidArguments;
+      }
+      if (replications == 0) {
+        result = codes::invalidArguments;
+      }
+    } else {
+      result = codes::invalidArguments;
+    }
+    optional_arguments.erase("-R");
+  };
+  optional_arguments["-C"] = [&] {
+    std::size_t next_argument_index = current_argument_index + 1;
+    if (next_argument_index <= last_argument_index) {
+      cache_path = argv[next_argument_index];
+      current_argument_index = next_argument_index;
+    } else {
+      result = codes::invalidArguments;
+    }
+    optional_arguments.erase("-C");
+  };
   bool has_parsed_input_file = false;
   while (result == codes::success && current_argument_index < argc) {
     auto current_argument = argv[current_argument_index];
@@ -68,7 +287,7 @@ codes::Result parse::Arguments::Parse(int argc, char** argv) {
       if (has_parsed_input_file) {
         result = codes::invalidArguments;
       } else {
-        input_file = std::ifstream(current_argument);
+        input_path = current_argument;
         has_parsed_input_file = true;
       }
     } else {
@@ -76,7 +295,10 @@ codes::Result parse::Arguments::Parse(int argc, char** argv) {
     }
     current_argument_index += 1;
   }
-  if (!has_parsed_input_file) {
+  // Differential testing and the network check make up their own models.
+  bool makes_own_model = mode == SimulationMode::differentialTesting ||
+                         mode == SimulationMode::networkCheck;
+  if (has_parsed_input_file == makes_own_model) {
     result = codes::invalidArguments;
   }
   return result;
@@ -2,11 +2,13 @@
 #define ARGUMENTS_PARSER_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <functional>
 #include <istream>
 #include <map>
 #include <optional>
+#include <string>
 
 #include "return_codes.h"
 #include "simulator.h"
@@ -15,15 +17,43 @@ enum class SimulationMode {
   runToCompletion,
   interactive,
   automatic,
+  benchmark,
+  capacitySearch,
+  lockstepBenchmark,
+  differentialTesting,
+  networkCheck,
+};
+enum class ReportFormat {
+  table,
+  csv,
+  jsonLines,
+  binary,
 };
 struct Arguments {
   codes::Result Parse(int argc, char** argv);
   std::size_t max_requests = 1'000'000;
+  std::size_t benchmark_cycles = 0;
+  std::size_t replications = 1;
+  std::size_t lanes = 0;
+  std::size_t differential_cases = 0;
+  std::size_t network_stations = 0;
+  double max_rejection_probability = 0.0;
+  smo::Time max_wait = 0;
   SimulationMode mode = SimulationMode::runToCompletion;
   smo::SimulatorLaw law = smo::SimulatorLaw::stochastic;
+  smo::DeviceGrouping device_grouping = smo::DeviceGrouping::individual;
+  smo::SourceArrivals source_arrivals = smo::SourceArrivals::periodic;
+  ReportFormat report_format = ReportFormat::table;
   bool need_output = false;
+  bool show_progress = false;
+  bool estimate_gradients = false;
   std::optional<std::ofstream> report_file;
-  std::ifstream input_file;
+  std::optional<std::ofstream> binary_config_file;
+  std::string input_path;
+  std::optional<std::string> arrival_trace_path;
+  std::optional<std::string> service_trace_path;
+  std::optional<std::uint64_t> seed;
+  std::optional<std::string> cache_path;
 };
 }  // namespace parse
 
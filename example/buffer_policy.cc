@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "../indexed_heap.h"
+#include "buffer_policy.h"
+
+std::optional<std::size_t> smo::BufferPolicy::current_packet() const {
+  return std::nullopt;
+}
+
+namespace {
+struct PriorityKey {
+  double value;
+  std::uint64_t sequence;
+};
+// Orders keys by value, then by arrival.
+struct PriorityKeyOrder {
+  bool operator()(const PriorityKey& lhs, const PriorityKey& rhs) const {
+    if (lhs.value != rhs.value) {
+      return is_descending ? lhs.value > rhs.value : lhs.value < rhs.value;
+    }
+    return is_descending ? lhs.sequence > rhs.sequence
+                         : lhs.sequence < rhs.sequence;
+  }
+
+  bool is_descending = false;
+};
+using PriorityHeap = smo::IndexedHeap<PriorityKey, PriorityKeyOrder>;
+
+// Drops the oldest request of the lowest priority packet, serves packets one
+// by one, starting from the highest priority one.
+class PacketBufferPolicy final : public smo::BufferPolicy {
+ public:
+  std::optional<smo::Request> Put(smo::BufferStorage& storage,
+                                  const smo::Request& request) override {
+    std::optional<smo::Request> rejected;
+    if (storage.full()) {
+      if (storage.empty()) {
+        return request;
+      }
+      std::size_t packet = storage.packets_amount() - 1;
+      while (storage.Packet(packet).empty()) {
+        packet -= 1;
+      }
+      rejected = storage.PopFront(packet);
+    }
+    storage.PushBack(request);
+    return rejected;
+  }
+  smo::Request Take(smo::BufferStorage& storage) override {
+    if (storage.Packet(current_packet_).empty()) {
+      current_packet_ = 0;
+      while (storage.Packet(current_packet_).empty()) {
+        current_packet_ += 1;
+      }
+    }
+    return storage.PopFront(current_packet_);
+  }
+  void Clear() override { current_packet_ = 0; }
+  std::optional<std::size_t> current_packet() const override {
+    return current_packet_;
+  }
+
+ private:
+  std::size_t current_packet_ = 0;
+};
+
+// Serves the oldest request, rejects new ones, when full.
+class FifoBufferPolicy final : public smo::BufferPolicy {
+ public:
+  std::optional<smo::Request> Put(smo::BufferStorage& storage,
+                                  const smo::Request& request) override {
+    if (storage.full()) {
+      return request;
+    }
+    storage.PushBack(request);
+    return std::nullopt;
+  }
+  smo::Request Take(smo::BufferStorage& storage) override {
+    return storage.Remove(storage.front_slot());
+  }
+};
+
+// Serves the newest request, pushes out the oldest one, when full.
+class LifoBufferPolicy final : public smo::BufferPolicy {
+ public:
+  std::optional<smo::Request> Put(smo::BufferStorage& storage,
+                                  const smo::Request& request) override {
+    std::optional<smo::Request> rejected;
+    if (storage.full()) {
+      if (storage.empty()) {
+        return request;
+      }
+      rejected = storage.Remove(storage.front_slot());
+    }
+    storage.PushBack(request);
+    return rejected;
+  }
+  smo::Request Take(smo::BufferStorage& storage) override {
+    return storage.Remove(storage.back_slot());
+  }
+};
+
+// Serves the request with the smallest key, pushes out the one with
+// the largest key, when full. Equal keys are ordered by arrival.
+class PriorityBufferPolicy : public smo::BufferPolicy {
+ public:
+  PriorityBufferPolicy(std::size_t capacity,
+                       std::pmr::memory_resource* resource)
+      : best_(capacity, PriorityKeyOrder{.is_descending = false}, resource),
+        worst_(capacity, PriorityKeyOrder{.is_descending = true}, resource) {}
+
+  std::optional<smo::Request> Put(smo::BufferStorage& storage,
+                                  const smo::Request& request) override {
+    PriorityKey key{Priority(request), sequence_++};
+    std::optional<smo::Request> rejected;
+    if (storage.full()) {
+      if (storage.empty()) {
+        return request;
+      }
+      auto worst_slot = worst_.top();
+      if (key.value >= worst_.key(worst_slot).value) {
+        return request;
+      }
+      best_.Remove(worst_slot);
+      worst_.Remove(worst_slot);
+      rejected = storage.Remove(worst_slot);
+    }
+    OnPut(request, key.value);
+    auto slot = storage.PushBack(request);
+    best_.Push(slot, key);
+    worst_.Push(slot, key);
+    return rejected;
+  }
+  smo::Request Take(smo::BufferStorage& storage) override {
+    auto slot = best_.top();
+    OnTake(best_.key(slot).value);
+    best_.Remove(slot);
+    worst_.Remove(slot);
+    return storage.Remove(slot);
+  }
+  void Clear() override {
+    best_.Clear();
+    worst_.Clear();
+    sequence_ = 0;
+  }
+
+ protected:
+  virtual double Priority(const smo::Request& request) const = 0;
+  virtual void OnPut(const smo::Request& request, double priority) {}
+  virtual void OnTake(double priority) {}
+
+ private:
+  PriorityHeap best_;
+  PriorityHeap worst_;
+  std::uint64_t sequence_ = 0;
+};
+
+// Deadline of a request is the moment, when its source makes the next one.
+class EarliestDeadlineBufferPolicy final : public PriorityBufferPolicy {
+ public:
+  EarliestDeadlineBufferPolicy(std::size_t capacity,
+                               std::span<const smo::Time> source_periods,
+                               std::pmr::memory_resource* resource)
+      : PriorityBufferPolicy(capacity, resource),
+        source_periods_(source_periods) {}
+
+ protected:
+  double Priority(const smo::Request& request) const override {
+    return static_cast<double>(request.generation_time +
+                               source_periods_[request.source_id]);
+  }
+
+ private:
+  std::span<const smo::Time> source_periods_;
+};
+
+class ShortestJobBufferPolicy final : public PriorityBufferPolicy {
+ public:
+  ShortestJobBufferPolicy(std::size_t capacity,
+                          std::span<const double> source_job_sizes,
+                          std::pmr::memory_resource* resource)
+      : PriorityBufferPolicy(capacity, resource),
+        source_job_sizes_(source_job_sizes) {}
+
+ protected:
+  double Priority(const smo::Request& request) const override {
+    return source_job_sizes_.empty() ? 1.0
+                                     : source_job_sizes_[request.source_id];
+  }
+
+ private:
+  std::span<const double> source_job_sizes_;
+};
+
+// Self-clocked fair queueing: a request is tagged with the virtual time, when
+// it would finish, if every source got its weighted share of service.
+class WeightedFairBufferPolicy final : public PriorityBufferPolicy {
+ public:
+  WeightedFairBufferPolicy(std::size_t capacity, std::size_t sources_amount,
+                           std::span<const double> source_weights,
+                           std::span<const double> source_job_sizes,
+                           std::pmr::memory_resource* resource)
+      : PriorityBufferPolicy(capacity, resource),
+        source_weights_(source_weights),
+        source_job_sizes_(source_job_sizes),
+        last_finish_(sources_amount, resource) {}
+
+  void Clear() override {
+    PriorityBufferPolicy::Clear();
+    std::fill(last_finish_.begin(), last_finish_.end(), 0.0);
+    virtual_time_ = 0.0;
+  }
+
+ protected:
+  double Priority(const smo::Request& request) const override {
+    auto id = request.source_id;
+    double weight = source_weights_.empty() ? 1.0 : source_weights_[id];
+    double size = source_job_sizes_.empty() ? 1.0 : source_job_sizes_[id];
+    return std::max(virtual_time_, last_finish_[id]) + size / weight;
+  }
+  void OnPut(const smo::Request& request, double priority) override {
+    last_finish_[request.source_id] = priority;
+  }
+  void OnTake(double priority) override { virtual_time_ = priority; }
+
+ private:
+  std::span<const double> source_weights_;
+  std::span<const double> source_job_sizes_;
+  std::pmr::vector<double> last_finish_;
+  double virtual_time_ = 0.0;
+};
+}  // namespace
+
+std::unique_ptr<smo::BufferPolicy> smo::MakeBufferPolicy(
+    const SimulatorConfig& config, std::pmr::memory_resource* resource) {
+  switch (config.buffer_discipline) {
+    case BufferDiscipline::packet:
+      return std::make_unique<PacketBufferPolicy>();
+    case BufferDiscipline::fifo:
+      return std::make_unique<FifoBufferPolicy>();
+    case BufferDiscipline::lifo:
+      return std::make_unique<LifoBufferPolicy>();
+    case BufferDiscipline::earliestDeadline:
+      return std::make_unique<EarliestDeadlineBufferPolicy>(
+          config.buffer_capacity, config.source_periods, resource);
+    case BufferDiscipline::shortestJob:
+      return std::make_unique<ShortestJobBufferPolicy>(
+          config.buffer_capacity, config.source_job_sizes, resource);
+    case BufferDiscipline::weightedFair:
+      return std::make_unique<WeightedFairBufferPolicy>(
+          config.buffer_capacity, config.source_periods.size(),
+          config.source_weights, config.source_job_sizes, resource);
+  }
+  return nullptr;
+}
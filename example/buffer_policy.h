@@ -0,0 +1,34 @@
+#ifndef BUFFER_POLICY_H_
+#define BUFFER_POLICY_H_
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+#include "../smo_components.h"
+#include "buffer_storage.h"
+#include "simulator_config.h"
+
+namespace smo {
+// Decides, which request leaves the buffer, when it's served or when the
+// buffer overflows. Requests themselves are kept in `BufferStorage`, policies
+// only index its slots.
+class BufferPolicy {
+ public:
+  virtual ~BufferPolicy() = default;
+
+  // Returns the rejected request, if the buffer overflows.
+  virtual std::optional<Request> Put(BufferStorage& storage,
+                                     const Request& request) = 0;
+  // Storage must not be empty.
+  virtual Request Take(BufferStorage& storage) = 0;
+  virtual void Clear() {}
+  // Packet, that is being served, for disciplines, that have one.
+  virtual std::optional<std::size_t> current_packet() const;
+};
+// Indexes of policies are allocated from `resource`.
+std::unique_ptr<BufferPolicy> MakeBufferPolicy(
+    const SimulatorConfig& config, std::pmr::memory_resource* resource);
+}  // namespace smo
+#endif
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "buffer_storage.h"
+
+smo::BufferStorage::Iterator::Iterator(const Slot* slots, std::size_t index,
+                                       std::size_t Slot::*link)
+    : slots_(slots), index_(index), link_(link) {}
+
+const smo::Request& smo::BufferStorage::Iterator::operator*() const {
+  return slots_[index_].request;
+}
+const smo::Request* smo::BufferStorage::Iterator::operator->() const {
+  return &slots_[index_].request;
+}
+smo::BufferStorage::Iterator& smo::BufferStorage::Iterator::operator++() {
+  index_ = slots_[index_].*link_;
+  return *this;
+}
+smo::BufferStorage::Iterator smo::BufferStorage::Iterator::operator++(int) {
+  auto result = *this;
+  ++*this;
+  return result;
+}
+bool smo::BufferStorage::Iterator::operator==(const Iterator& other) const {
+  return index_ == other.index_;
+}
+
+smo::BufferStorage::Range::Range(Iterator begin, Iterator end,
+                                 std::size_t size)
+    : begin_(begin), end_(end), size_(size) {}
+
+smo::BufferStorage::Iterator smo::BufferStorage::Range::begin() const {
+  return begin_;
+}
+smo::BufferStorage::Iterator smo::BufferStorage::Range::end() const {
+  return end_;
+}
+std::size_t smo::BufferStorage::Range::size() const { return size_; }
+bool smo::BufferStorage::Range::empty() const { return size_ == 0; }
+
+smo::BufferStorage::BufferStorage(std::size_t capacity,
+                                  std::size_t packets_amount,
+                                  std::pmr::memory_resource* resource)
+    : slots_(capacity, resource), packets_(packets_amount, resource) {}
+
+void smo::BufferStorage::Clear() {
+  std::fill(packets_.begin(), packets_.end(), PacketQueue{});
+  used_slots_ = 0;
+  free_slot_ = npos;
+  head_ = npos;
+  tail_ = npos;
+  size_ = 0;
+}
+
+std::size_t smo::BufferStorage::AllocateSlot() {
+  if (free_slot_ == npos) {
+    return used_slots_++;
+  }
+  auto result = free_slot_;
+  free_slot_ = slots_[result].next;
+  return result;
+}
+
+std::size_t smo::BufferStorage::PushBack(const Request& request) {
+  auto index = AllocateSlot();
+  auto& slot = slots_[index];
+  slot.request = request;
+  slot.previous = tail_;
+  slot.next = npos;
+  if (tail_ == npos) {
+    head_ = index;
+  } else {
+    slots_[tail_].next = index;
+  }
+  tail_ = index;
+
+  auto& packet = packets_[request.source_id];
+  slot.previous_in_packet = packet.tail;
+  slot.next_in_packet = npos;
+  if (packet.tail == npos) {
+    packet.head = index;
+  } else {
+    slots_[packet.tail].next_in_packet = index;
+  }
+  packet.tail = index;
+  packet.size += 1;
+  size_ += 1;
+  return index;
+}
+
+smo::Request smo::BufferStorage::PopFront(std::size_t packet) {
+  return Remove(packets_[packet].head);
+}
+
+smo::Request smo::BufferStorage::Remove(std::size_t index) {
+  auto& slot = slots_[index];
+  auto& packet = packets_[slot.request.source_id];
+  if (slot.previous_in_packet == npos) {
+    packet.head = slot.next_in_packet;
+  } else {
+    slots_[slot.previous_in_packet].next_in_packet = slot.next_in_packet;
+  }
+  if (slot.next_in_packet == npos) {
+    packet.tail = slot.previous_in_packet;
+  } else {
+    slots_[slot.next_in_packet].previous_in_packet = slot.previous_in_packet;
+  }
+  packet.size -= 1;
+
+  if (slot.previous == npos) {
+    head_ = slot.next;
+  } else {
+    slots_[slot.previous].next = slot.next;
+  }
+  if (slot.next == npos) {
+    tail_ = slot.previous;
+  } else {
+    slots_[slot.next].previous = slot.previous;
+  }
+  size_ -= 1;
+
+  slot.next = free_slot_;
+  free_slot_ = index;
+  return slot.request;
+}
+
+smo::BufferStorage::Range smo::BufferStorage::ArrivalOrder() const {
+  return Range(Iterator(slots_.data(), head_, &Slot::next),
+               Iterator(slots_.data(), npos, &Slot::next), size_);
+}
+smo::BufferStorage::Range smo::BufferStorage::Packet(
+    std::size_t packet) const {
+  const auto& queue = packets_[packet];
+  return Range(Iterator(slots_.data(), queue.head, &Slot::next_in_packet),
+               Iterator(slots_.data(), npos, &Slot::next_in_packet),
+               queue.size);
+}
+std::size_t smo::BufferStorage::front_slot() const { return head_; }
+std::size_t smo::BufferStorage::back_slot() const { return tail_; }
+const smo::Request& smo::BufferStorage::operator[](std::size_t slot) const {
+  return slots_[slot].request;
+}
+std::size_t smo::BufferStorage::packets_amount() const {
+  return packets_.size();
+}
+std::size_t smo::BufferStorage::size() const { return size_; }
+std::size_t smo::BufferStorage::capacity() const { return slots_.size(); }
+bool smo::BufferStorage::empty() const { return size_ == 0; }
+bool smo::BufferStorage::full() const { return size_ == slots_.size(); }
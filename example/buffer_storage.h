@@ -0,0 +1,112 @@
+#ifndef BUFFER_STORAGE_H_
+#define BUFFER_STORAGE_H_
+
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
+#include <vector>
+
+#include "../smo_components.h"
+
+namespace smo {
+// Fixed-capacity storage of buffered requests. Every request is linked both
+// into the arrival order of the whole buffer and into the queue of its packet,
+// so either order can be walked without sorting, copying or allocating.
+// Requests are addressed by slots, which stay the same while they're stored.
+class BufferStorage {
+  struct Slot;
+
+ public:
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Request;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Request*;
+    using reference = const Request&;
+
+    Iterator() = default;
+    reference operator*() const;
+    pointer operator->() const;
+    Iterator& operator++();
+    Iterator operator++(int);
+    bool operator==(const Iterator& other) const;
+
+   private:
+    friend class BufferStorage;
+    Iterator(const Slot* slots, std::size_t index, std::size_t Slot::*link);
+
+    const Slot* slots_ = nullptr;
+    std::size_t index_ = npos;
+    std::size_t Slot::*link_ = nullptr;
+  };
+
+  class Range {
+   public:
+    Iterator begin() const;
+    Iterator end() const;
+    std::size_t size() const;
+    bool empty() const;
+
+   private:
+    friend class BufferStorage;
+    Range(Iterator begin, Iterator end, std::size_t size);
+
+    Iterator begin_;
+    Iterator end_;
+    std::size_t size_;
+  };
+
+  BufferStorage(std::size_t capacity, std::size_t packets_amount,
+                std::pmr::memory_resource* resource =
+                    std::pmr::get_default_resource());
+
+  void Clear();
+  // Storage must not be full. Returns the slot of the request.
+  std::size_t PushBack(const Request& request);
+  // Packet must not be empty.
+  Request PopFront(std::size_t packet);
+  Request Remove(std::size_t slot);
+  // Slots of the oldest and the newest requests, or npos if empty.
+  std::size_t front_slot() const;
+  std::size_t back_slot() const;
+  const Request& operator[](std::size_t slot) const;
+  Range ArrivalOrder() const;
+  Range Packet(std::size_t packet) const;
+  std::size_t packets_amount() const;
+  std::size_t size() const;
+  std::size_t capacity() const;
+  bool empty() const;
+  bool full() const;
+
+ private:
+  struct Slot {
+    Request request;
+    std::size_t previous = npos;
+    std::size_t next = npos;
+    std::size_t previous_in_packet = npos;
+    std::size_t next_in_packet = npos;
+  };
+  struct PacketQueue {
+    std::size_t head = npos;
+    std::size_t tail = npos;
+    std::size_t size = 0;
+  };
+
+  std::size_t AllocateSlot();
+
+  std::pmr::vector<Slot> slots_;
+  std::pmr::vector<PacketQueue> packets_;
+  // Slots past `used_slots_` have never been taken since the last `Clear`,
+  // released ones are chained through `next`.
+  std::size_t used_slots_ = 0;
+  std::size_t free_slot_ = npos;
+  std::size_t head_ = npos;
+  std::size_t tail_ = npos;
+  std::size_t size_ = 0;
+};
+}  // namespace smo
+#endif
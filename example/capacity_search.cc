@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "capacity_search.h"
+
+namespace {
+// Mean of batch means and its variance, by Welford's method.
+class BatchMeans {
+ public:
+  void Add(double value) {
+    size_ += 1;
+    auto delta = value - mean_;
+    mean_ += delta / size_;
+    squared_deviations_ += delta * (value - mean_);
+  }
+  double HalfWidth(double quantile) const {
+    return quantile * std::sqrt(squared_deviations_ / (size_ - 1) / size_);
+  }
+  double mean() const { return mean_; }
+  std::size_t size() const { return size_; }
+
+ private:
+  std::size_t size_ = 0;
+  double mean_ = 0.0;
+  double squared_deviations_ = 0.0;
+};
+enum class Verdict { undecided, meets, misses };
+
+class CapacitySearch {
+ public:
+  CapacitySearch(const smo::SimulatorConfig& config,
+                 const smo::ServiceLevel& level,
+                 const smo::CapacitySearchOptions& options)
+      : config_(config), level_(level), options_(options) {}
+
+  smo::CapacitySearchResult Run();
+
+ private:
+  std::optional<smo::CapacityPoint> LeastBuffer(std::size_t devices);
+  smo::CapacityPoint Evaluate(std::size_t devices,
+                              std::size_t buffer_capacity);
+  smo::CapacityPoint Simulate(std::size_t devices,
+                              std::size_t buffer_capacity) const;
+  Verdict Decide(const BatchMeans& means, double limit) const;
+
+  const smo::SimulatorConfig& config_;
+  const smo::ServiceLevel& level_;
+  const smo::CapacitySearchOptions& options_;
+  std::size_t threads_ = 1;
+  std::mutex mutex_;
+  std::vector<smo::CapacityPoint> evaluated_;
+};
+}  // namespace
+
+// Evaluates every value in a thread of its own.
+static std::vector<char> EvaluateAll(
+    std::span<const std::size_t> values,
+    const std::function<bool(std::size_t)>& passes) {
+  std::vector<char> results(values.size());
+  if (values.size() == 1) {
+    results[0] = passes(values[0]);
+    return results;
+  }
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    threads.emplace_back([&, i] { results[i] = passes(values[i]); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return results;
+}
+
+// Least value in [low, high], for which monotone `passes` is true. Gallops
+// up from `low`, and then splits the bracket into `threads` + 1 parts, so
+// that a single thread bisects.
+static std::optional<std::size_t> SmallestPassing(
+    std::size_t low, std::size_t high, std::size_t threads,
+    const std::function<bool(std::size_t)>& passes) {
+  std::vector<std::size_t> values;
+  std::size_t step = 1;
+  std::size_t next = low;
+  std::optional<std::size_t> passing;
+  while (!passing.has_value()) {
+    values.clear();
+    while (values.size() < threads && next <= high) {
+      values.push_back(next);
+      next = next == high ? high + 1 : next + std::min(step, high - next);
+      step *= 2;
+    }
+    if (values.empty()) {
+      return std::nullopt;
+    }
+    auto results = EvaluateAll(values, passes);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      if (results[i]) {
+        passing = values[i];
+        break;
+      }
+      low = values[i] + 1;
+    }
+  }
+  // Answer is in [low, *passing].
+  while (low < *passing) {
+    std::size_t width = *passing - low;
+    values.clear();
+    for (std::size_t i = 0; i < std::min(threads, width); ++i) {
+      values.push_back(low + (i + 1) * width / (std::min(threads, width) + 1));
+    }
+    auto results = EvaluateAll(values, passes);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      if (results[i]) {
+        passing = values[i];
+        break;
+      }
+      low = values[i] + 1;
+    }
+  }
+  return passing;
+}
+
+smo::CapacitySearchResult smo::SearchCapacity(
+    const SimulatorConfig& config, const ServiceLevel& level,
+    const CapacitySearchOptions& options) {
+  return CapacitySearch(config, level, options).Run();
+}
+
+// Devices are searched one amount at a time, since each amount runs a
+// parallel search of its own.
+smo::CapacitySearchResult CapacitySearch::Run() {
+  threads_ = options_.threads != 0
+                 ? options_.threads
+                 : std::max(std::thread::hardware_concurrency(), 1u);
+  std::vector<std::optional<smo::CapacityPoint>> least_buffers(
+      config_.device_coefficients.size() + 1);
+  auto devices = SmallestPassing(
+      1, config_.device_coefficients.size(), 1, [&](std::size_t devices) {
+        least_buffers[devices] = LeastBuffer(devices);
+        return least_buffers[devices].has_value() &&
+               least_buffers[devices]->meets_wait;
+      });
+  smo::CapacitySearchResult result;
+  if (devices.has_value()) {
+    result.minimum = least_buffers[*devices];
+  }
+  result.evaluated = std::move(evaluated_);
+  return result;
+}
+
+// Least buffer capacity, which meets the rejection limit. Search stops at
+// a point missing both limits as well, since larger buffers only make
+// waits longer, and both conditions grow with capacity.
+std::optional<smo::CapacityPoint> CapacitySearch::LeastBuffer(
+    std::size_t devices) {
+  auto buffer_capacity = SmallestPassing(
+      0, config_.buffer_capacity, threads_, [&](std::size_t buffer_capacity) {
+        auto point = Evaluate(devices, buffer_capacity);
+        return point.meets_rejection || !point.meets_wait;
+      });
+  if (!buffer_capacity.has_value()) {
+    return std::nullopt;
+  }
+  std::lock_guard lock(mutex_);
+  auto point = std::find_if(evaluated_.begin(), evaluated_.end(),
+                            [&](const smo::CapacityPoint& point) {
+                              return point.devices == devices &&
+                                     point.buffer_capacity == *buffer_capacity;
+                            });
+  if (!point->meets_rejection) {
+    return std::nullopt;
+  }
+  return *point;
+}
+
+smo::CapacityPoint CapacitySearch::Evaluate(std::size_t devices,
+                                            std::size_t buffer_capacity) {
+  auto point = Simulate(devices, buffer_capacity);
+  std::lock_guard lock(mutex_);
+  evaluated_.push_back(point);
+  return point;
+}
+
+smo::CapacityPoint CapacitySearch::Simulate(
+    std::size_t devices, std::size_t buffer_capacity) const {
+  auto config = config_;
+  config.buffer_capacity = buffer_capacity;
+  config.device_coefficients = config.device_coefficients.first(devices);
+  smo::Simulator simulator(config, options_.law, options_.grouping,
+                           options_.arrivals);
+  simulator.Seed(options_.seed);
+  simulator.SetWaitThreshold(level_.max_wait);
+  auto target = simulator.target_amount_of_requests();
+  auto batch_size = std::max<std::size_t>(target / options_.batches, 1);
+  double late_limit = 1.0 - level_.wait_quantile;
+  smo::CapacityPoint point{devices, buffer_capacity};
+  BatchMeans rejections;
+  BatchMeans lates;
+  std::size_t recieved = 0;
+  std::size_t rejected = 0;
+  std::size_t late = 0;
+  bool is_warming_up = true;
+  while (true) {
+    auto boundary = std::min(target, recieved + batch_size);
+    while (!simulator.is_completed() &&
+           simulator.current_amount_of_requests() < boundary) {
+      simulator.Step();
+    }
+    auto batch_recieved = simulator.current_amount_of_requests() - recieved;
+    auto batch_rejected = simulator.rejected_amount() - rejected;
+    auto batch_served = batch_recieved - batch_rejected;
+    auto batch_late = simulator.late_amount() - late;
+    recieved += batch_recieved;
+    rejected += batch_rejected;
+    late += batch_late;
+    if (!is_warming_up && batch_recieved != 0) {
+      rejections.Add(static_cast<double>(batch_rejected) / batch_recieved);
+      lates.Add(batch_served == 0
+                    ? 0.0
+                    : static_cast<double>(batch_late) / batch_served);
+    }
+    is_warming_up = false;
+    if (recieved >= target || simulator.is_completed()) {
+      simulator.RunToCompletion();
+      break;
+    }
+    if (rejections.size() >= std::max<std::size_t>(options_.min_batches, 2)) {
+      auto rejection_verdict =
+          Decide(rejections, level_.max_rejection_probability);
+      auto wait_verdict = Decide(lates, late_limit);
+      if (rejection_verdict != Verdict::undecided &&
+          wait_verdict != Verdict::undecided) {
+        point.is_stopped_early = true;
+        point.meets_rejection = rejection_verdict == Verdict::meets;
+        point.meets_wait = wait_verdict == Verdict::meets;
+        break;
+      }
+    }
+  }
+  recieved = simulator.current_amount_of_requests();
+  rejected = simulator.rejected_amount();
+  point.simulated_requests = recieved;
+  point.rejection_probability =
+      recieved == 0 ? 0.0 : static_cast<double>(rejected) / recieved;
+  point.late_share = recieved == rejected
+                         ? 0.0
+                         : static_cast<double>(simulator.late_amount()) /
+                               (recieved - rejected);
+  if (!point.is_stopped_early) {
+    point.meets_rejection =
+        point.rejection_probability < level_.max_rejection_probability;
+    point.meets_wait = point.late_share < late_limit;
+  }
+  return point;
+}
+
+Verdict CapacitySearch::Decide(const BatchMeans& means, double limit) const {
+  auto half_width = means.HalfWidth(options_.confidence_quantile);
+  if (means.mean() + half_width < limit) {
+    return Verdict::meets;
+  }
+  if (means.mean() - half_width > limit) {
+    return Verdict::misses;
+  }
+  return Verdict::undecided;
+}
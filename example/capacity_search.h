@@ -0,0 +1,70 @@
+#ifndef CAPACITY_SEARCH_H_
+#define CAPACITY_SEARCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "../smo_components.h"
+#include "simulator.h"
+#include "simulator_config.h"
+
+namespace smo {
+struct ServiceLevel {
+  double max_rejection_probability = 0.0;
+  // At least this share of served requests waits in buffer no longer than
+  // `max_wait`, so 0.99 bounds the 99th percentile of waiting time.
+  double wait_quantile = 0.99;
+  Time max_wait = maxTime;
+};
+struct CapacitySearchOptions {
+  SimulatorLaw law = SimulatorLaw::stochastic;
+  DeviceGrouping grouping = DeviceGrouping::individual;
+  SourceArrivals arrivals = SourceArrivals::periodic;
+  // Every point is simulated with the same seed, so that neighbouring
+  // points see the same arrivals, and their comparison is less noisy.
+  std::uint64_t seed = 0;
+  // Zero means hardware concurrency.
+  std::size_t threads = 0;
+  // A full run, which is target amount of requests of the config, is split
+  // into this many batches. The first one is a warm-up.
+  std::size_t batches = 50;
+  // Batches, after which a run may stop early.
+  std::size_t min_batches = 10;
+  // Normal quantile of confidence intervals of batch means.
+  double confidence_quantile = 2.576;
+};
+struct CapacityPoint {
+  std::size_t devices = 0;
+  std::size_t buffer_capacity = 0;
+  double rejection_probability = 0.0;
+  // Share of served requests, which wait longer than the limit.
+  double late_share = 0.0;
+  std::size_t simulated_requests = 0;
+  bool is_stopped_early = false;
+  bool meets_rejection = false;
+  bool meets_wait = false;
+};
+struct CapacitySearchResult {
+  // Least devices, and then least buffer capacity, which meet the level.
+  std::optional<CapacityPoint> minimum;
+  // In order of evaluation.
+  std::vector<CapacityPoint> evaluated;
+};
+// Config describes the largest system: its buffer capacity and devices
+// bound the search, and a candidate with n devices takes the first n of
+// them.
+//
+// Rejections fall and waits grow with buffer capacity, so for a fixed
+// amount of devices the least capacity, which meets the rejection limit,
+// is the only one worth checking against the wait limit. Both fall with
+// devices. The search gallops and bisects devices, and for each amount
+// it does the same with buffer capacity, simulating several candidates in
+// parallel. Runs stop, once confidence intervals of both measures are
+// clear of their limits, otherwise point estimates decide.
+CapacitySearchResult SearchCapacity(const SimulatorConfig& config,
+                                    const ServiceLevel& level,
+                                    const CapacitySearchOptions& options);
+}  // namespace smo
+#endif
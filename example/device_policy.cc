@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "device_policy.h"
+
+namespace {
+// Takes the next free device after the previously picked one.
+class RoundRobinDevicePolicy final : public smo::DevicePolicy {
+ public:
+  explicit RoundRobinDevicePolicy(
+      const std::pmr::vector<smo::DeviceStatistics>& devices)
+      : devices_(devices), next_device_pointer_(devices.begin()) {}
+
+  std::optional<std::size_t> Pick() override {
+    std::optional<std::size_t> result;
+    auto DeviceIsOccupied = [](const smo::DeviceStatistics& device) {
+      return device.current_request.has_value();
+    };
+    auto candidate = std::find_if_not(next_device_pointer_, devices_.end(),
+                                      DeviceIsOccupied);
+    if (candidate != devices_.end()) {
+      result = candidate - devices_.begin();
+    }
+    if (!result.has_value()) {
+      candidate = std::find_if_not(devices_.begin(), next_device_pointer_,
+                                   DeviceIsOccupied);
+    }
+    if (candidate != next_device_pointer_) {
+      result = candidate - devices_.begin();
+    }
+    if (result.has_value()) {
+      if (++candidate == devices_.end()) {
+        next_device_pointer_ = devices_.begin();
+      } else {
+        next_device_pointer_ = candidate;
+      }
+    }
+    return result;
+  }
+  void Release(std::size_t device_id) override {}
+  void Clear() override { next_device_pointer_ = devices_.begin(); }
+
+ private:
+  const std::pmr::vector<smo::DeviceStatistics>& devices_;
+  std::pmr::vector<smo::DeviceStatistics>::const_iterator next_device_pointer_;
+};
+
+// Heap of free devices ordered by a key, that is taken when a device
+// becomes free. Ties go to the lowest id.
+class KeyedDevicePolicy : public smo::DevicePolicy {
+ public:
+  KeyedDevicePolicy(const std::pmr::vector<smo::DeviceStatistics>& devices,
+                    std::pmr::memory_resource* resource)
+      : devices_(devices), free_devices_(resource) {
+    free_devices_.reserve(devices.size());
+  }
+
+  std::optional<std::size_t> Pick() override {
+    if (free_devices_.empty()) {
+      return std::nullopt;
+    }
+    std::pop_heap(free_devices_.begin(), free_devices_.end(),
+                  std::greater<Entry>());
+    auto device_id = free_devices_.back().second;
+    free_devices_.pop_back();
+    return device_id;
+  }
+  void Release(std::size_t device_id) override {
+    free_devices_.emplace_back(Key(device_id), device_id);
+    std::push_heap(free_devices_.begin(), free_devices_.end(),
+                   std::greater<Entry>());
+  }
+  void Clear() override {
+    free_devices_.clear();
+    for (std::size_t i = 0; i < devices_.size(); ++i) {
+      free_devices_.emplace_back(Key(i), i);
+    }
+    std::make_heap(free_devices_.begin(), free_devices_.end(),
+                   std::greater<Entry>());
+  }
+
+ protected:
+  virtual double Key(std::size_t device_id) const = 0;
+
+  const std::pmr::vector<smo::DeviceStatistics>& devices_;
+
+ private:
+  using Entry = std::pair<double, std::size_t>;
+
+  // Min-heap by key, then by id.
+  std::pmr::vector<Entry> free_devices_;
+};
+
+class FastestDevicePolicy final : public KeyedDevicePolicy {
+ public:
+  FastestDevicePolicy(const std::pmr::vector<smo::DeviceStatistics>& devices,
+                      std::span<const double> device_coefficients,
+                      std::pmr::memory_resource* resource)
+      : KeyedDevicePolicy(devices, resource),
+        device_coefficients_(device_coefficients) {
+    Clear();
+  }
+
+ protected:
+  double Key(std::size_t device_id) const override {
+    return device_coefficients_[device_id];
+  }
+
+ private:
+  std::span<const double> device_coefficients_;
+};
+
+// Usage of a free device doesn't change, so it's a stable key.
+class LeastUsedDevicePolicy final : public KeyedDevicePolicy {
+ public:
+  LeastUsedDevicePolicy(const std::pmr::vector<smo::DeviceStatistics>& devices,
+                        std::pmr::memory_resource* resource)
+      : KeyedDevicePolicy(devices, resource) {
+    Clear();
+  }
+
+ protected:
+  double Key(std::size_t device_id) const override {
+    return static_cast<double>(devices_[device_id].time_in_usage);
+  }
+};
+
+// Free devices are kept in an array, picked one is swapped with the last.
+class RandomDevicePolicy final : public smo::DevicePolicy {
+ public:
+  RandomDevicePolicy(std::size_t devices_amount, std::mt19937& random_gen,
+                     std::pmr::memory_resource* resource)
+      : random_gen_(random_gen),
+        devices_amount_(devices_amount),
+        free_devices_(resource) {
+    free_devices_.reserve(devices_amount);
+    Clear();
+  }
+
+  std::optional<std::size_t> Pick() override {
+    if (free_devices_.empty()) {
+      return std::nullopt;
+    }
+    std::uniform_int_distribution<std::size_t> distribution(
+        0, free_devices_.size() - 1);
+    auto index = distribution(random_gen_);
+    auto device_id = free_devices_[index];
+    free_devices_[index] = free_devices_.back();
+    free_devices_.pop_back();
+    return device_id;
+  }
+  void Release(std::size_t device_id) override {
+    free_devices_.push_back(device_id);
+  }
+  void Clear() override {
+    free_devices_.clear();
+    for (std::size_t i = 0; i < devices_amount_; ++i) {
+      free_devices_.push_back(i);
+    }
+  }
+
+ private:
+  std::mt19937& random_gen_;
+  std::size_t devices_amount_;
+  std::pmr::vector<std::size_t> free_devices_;
+};
+}  // namespace
+
+std::unique_ptr<smo::DevicePolicy> smo::MakeDevicePolicy(
+    const SimulatorConfig& config,
+    const std::pmr::vector<DeviceStatistics>& devices,
+    std::mt19937& random_gen, std::pmr::memory_resource* resource) {
+  switch (config.device_selection) {
+    case DeviceSelection::roundRobin:
+      return std::make_unique<RoundRobinDevicePolicy>(devices);
+    case DeviceSelection::fastest:
+      return std::make_unique<FastestDevicePolicy>(
+          devices, config.device_coefficients, resource);
+    case DeviceSelection::leastUsed:
+      return std::make_unique<LeastUsedDevicePolicy>(devices, resource);
+    case DeviceSelection::random:
+      return std::make_unique<RandomDevicePolicy>(devices.size(), random_gen,
+                                                  resource);
+  }
+  return nullptr;
+}
@@ -0,0 +1,34 @@
+#ifndef DEVICE_POLICY_H_
+#define DEVICE_POLICY_H_
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "../smo_components.h"
+#include "simulator_config.h"
+
+namespace smo {
+// Picks a free device for a request. Policies keep their own index of free
+// devices, so they must be told about every release.
+class DevicePolicy {
+ public:
+  virtual ~DevicePolicy() = default;
+
+  // Returns std::nullopt, if every device is occupied.
+  virtual std::optional<std::size_t> Pick() = 0;
+  virtual void Release(std::size_t device_id) = 0;
+  // Marks every device as free.
+  virtual void Clear() = 0;
+};
+// `devices` and `random_gen` must outlive the policy. Indexes of free devices
+// are allocated from `resource`.
+std::unique_ptr<DevicePolicy> MakeDevicePolicy(
+    const SimulatorConfig& config,
+    const std::pmr::vector<DeviceStatistics>& devices,
+    std::mt19937& random_gen, std::pmr::memory_resource* resource);
+}  // namespace smo
+#endif
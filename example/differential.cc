@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "differential.h"
+#include "lockstep_simulator.h"
+
+smo::SimulatorConfig smo::DifferentialCase::config() const {
+  auto result = MakeSimulatorConfig(buffer_capacity, target_amount_of_requests,
+                                    source_periods, device_coefficients);
+  result.buffer_discipline = buffer_discipline;
+  result.device_selection = device_selection;
+  return result;
+}
+
+namespace {
+class LockstepEngine final : public smo::AlternateEngine {
+ public:
+  LockstepEngine(const smo::DifferentialCase& test_case, std::size_t lanes)
+      : simulator_(test_case.config(), test_case.law, test_case.arrivals,
+                   lanes) {
+    simulator_.Seed(test_case.seed);
+  }
+
+  std::size_t replications() const override { return simulator_.lanes(); }
+  void Step(std::span<smo::SpecialEvent> events) override {
+    simulator_.Step(events);
+  }
+  smo::SimulationResults results(std::size_t replication) const override {
+    return simulator_.lane_results(replication);
+  }
+
+ private:
+  smo::LockstepSimulator simulator_;
+};
+}  // namespace
+
+smo::AlternateEngineFactory smo::LockstepEngineFactory(std::size_t lanes) {
+  return AlternateEngineFactory{
+      .coverage = {.buffer_disciplines = {BufferDiscipline::fifo},
+                   .device_selections = {DeviceSelection::roundRobin},
+                   .laws = {SimulatorLaw::deterministic},
+                   .arrivals = {SourceArrivals::periodic}},
+      .make = [lanes](const DifferentialCase& test_case)
+          -> std::unique_ptr<AlternateEngine> {
+        return std::make_unique<LockstepEngine>(test_case, lanes);
+      },
+  };
+}
+
+// Small models, where ties and full buffers are frequent.
+smo::DifferentialCase smo::RandomCase(const DifferentialCoverage& coverage,
+                                      std::mt19937_64& random_gen) {
+  auto Uniform = [&](std::size_t min, std::size_t max) {
+    return std::uniform_int_distribution<std::size_t>{min, max}(random_gen);
+  };
+  auto Pick = [&](const auto& values) {
+    return values[Uniform(0, values.size() - 1)];
+  };
+  DifferentialCase test_case;
+  test_case.buffer_capacity = Uniform(0, 4);
+  test_case.target_amount_of_requests = Uniform(1, 300);
+  test_case.source_periods.resize(Uniform(1, 4));
+  for (auto& period : test_case.source_periods) {
+    period = Uniform(1, 40);
+  }
+  test_case.device_coefficients.resize(Uniform(1, 4));
+  for (auto& coefficient : test_case.device_coefficients) {
+    coefficient = Uniform(1, 80);
+  }
+  test_case.buffer_discipline = Pick(coverage.buffer_disciplines);
+  test_case.device_selection = Pick(coverage.device_selections);
+  test_case.law = Pick(coverage.laws);
+  if (test_case.law == SimulatorLaw::stochastic) {
+    test_case.arrivals = Pick(coverage.arrivals);
+    test_case.seed = random_gen();
+  }
+  return test_case;
+}
+
+static const char* KindName(smo::SpecialEventKind kind) {
+  switch (kind) {
+    case smo::SpecialEventKind::endOfSimulation:
+      return "end of simulation";
+    case smo::SpecialEventKind::generateNewRequest:
+      return "new request";
+    case smo::SpecialEventKind::deviceRelease:
+      return "device release";
+    case smo::SpecialEventKind::deviceClassRelease:
+      return "device class release";
+  }
+  return "";
+}
+static std::string Describe(const smo::SpecialEvent& event) {
+  std::string description = KindName(event.kind);
+  if (event.kind != smo::SpecialEventKind::endOfSimulation) {
+    description += " of " + std::to_string(event.id) + " at " +
+                   std::to_string(event.planned_time);
+  }
+  return description;
+}
+static bool IsSameEvent(const smo::SpecialEvent& lhs,
+                        const smo::SpecialEvent& rhs) {
+  if (lhs.kind == smo::SpecialEventKind::endOfSimulation) {
+    return rhs.kind == lhs.kind;
+  }
+  return lhs.kind == rhs.kind && lhs.planned_time == rhs.planned_time &&
+         lhs.id == rhs.id;
+}
+
+// Engines, which handle the same events in the same order, add up the same
+// numbers in the same order, so even floating point sums match exactly.
+static std::optional<std::string> CompareResults(
+    const smo::SimulationResults& expected,
+    const smo::SimulationResults& actual) {
+  std::ostringstream difference;
+  auto Compare = [&](const char* name, auto expected_value,
+                     auto actual_value) {
+    if (expected_value != actual_value && difference.tellp() == 0) {
+      difference << name << ": expected " << expected_value << ", got "
+                 << actual_value;
+    }
+  };
+  Compare("simulation time", expected.simulation_time,
+          actual.simulation_time);
+  Compare("requests recieved", expected.recieved, actual.recieved);
+  Compare("requests rejected", expected.rejected, actual.rejected);
+  for (std::size_t i = 0; i < expected.sources.size(); ++i) {
+    const auto& source = expected.sources[i];
+    const auto& other = actual.sources[i];
+    Compare("generated", source.generated, other.generated);
+    Compare("rejected", source.rejected, other.rejected);
+    Compare("time in buffer", source.time_in_buffer, other.time_in_buffer);
+    Compare("time in device", source.time_in_device, other.time_in_device);
+    Compare("squared time in buffer", source.time_squared_in_buffer,
+            other.time_squared_in_buffer);
+    Compare("squared time in device", source.time_squared_in_device,
+            other.time_squared_in_device);
+    if (difference.tellp() != 0) {
+      return "source " + std::to_string(i) + " " + difference.str();
+    }
+  }
+  for (std::size_t i = 0; i < expected.devices.size(); ++i) {
+    Compare("time in usage", expected.devices[i].time_in_usage,
+            actual.devices[i].time_in_usage);
+    if (difference.tellp() != 0) {
+      return "device " + std::to_string(i) + " " + difference.str();
+    }
+  }
+  if (difference.tellp() != 0) {
+    return difference.str();
+  }
+  return std::nullopt;
+}
+
+std::optional<std::string> smo::CompareEngines(
+    const DifferentialCase& test_case, const AlternateEngineFactory& factory) {
+  Simulator simulator(test_case.config(), test_case.law,
+                      DeviceGrouping::individual, test_case.arrivals);
+  simulator.Seed(test_case.seed);
+  auto engine = factory.make(test_case);
+  std::vector<SpecialEvent> events(engine->replications());
+  for (std::size_t i = 0;; ++i) {
+    auto expected = simulator.Step();
+    engine->Step(events);
+    for (std::size_t replication = 0; replication < events.size();
+         ++replication) {
+      if (!IsSameEvent(expected, events[replication])) {
+        return "event " + std::to_string(i) + " of replication " +
+               std::to_string(replication) + ": expected " +
+               Describe(expected) + ", got " + Describe(events[replication]);
+      }
+    }
+    if (expected.kind == SpecialEventKind::endOfSimulation) {
+      break;
+    }
+  }
+  auto expected = CollectResults(simulator);
+  for (std::size_t replication = 0; replication < events.size();
+       ++replication) {
+    auto difference = CompareResults(expected, engine->results(replication));
+    if (difference.has_value()) {
+      return "replication " + std::to_string(replication) + " " + *difference;
+    }
+  }
+  return std::nullopt;
+}
+
+// The least first, so that shrinking takes big steps while it can.
+static std::vector<std::size_t> SmallerValues(std::size_t value,
+                                              std::size_t min) {
+  std::vector<std::size_t> values;
+  for (auto smaller : {min, value / 2, value - 1}) {
+    if (smaller >= min && smaller < value &&
+        std::find(values.begin(), values.end(), smaller) == values.end()) {
+      values.push_back(smaller);
+    }
+  }
+  return values;
+}
+
+// Smaller variants of the case, the most aggressive first.
+static std::vector<smo::DifferentialCase> ShrinkCandidates(
+    const smo::DifferentialCase& test_case) {
+  std::vector<smo::DifferentialCase> candidates;
+  auto AddSmaller = [&](auto member, std::size_t min) {
+    for (auto smaller : SmallerValues(test_case.*member, min)) {
+      candidates.push_back(test_case);
+      candidates.back().*member = smaller;
+    }
+  };
+  auto AddWithout = [&](auto member) {
+    const auto& values = test_case.*member;
+    for (std::size_t i = 0; values.size() > 1 && i < values.size(); ++i) {
+      candidates.push_back(test_case);
+      auto& candidate_values = candidates.back().*member;
+      candidate_values.erase(candidate_values.begin() + i);
+    }
+  };
+  auto AddSmallerValues = [&](auto member) {
+    const auto& values = test_case.*member;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      for (auto smaller :
+           SmallerValues(static_cast<std::size_t>(values[i]), 1)) {
+        candidates.push_back(test_case);
+        (candidates.back().*member)[i] = smaller;
+      }
+    }
+  };
+  AddSmaller(&smo::DifferentialCase::target_amount_of_requests, 1);
+  AddWithout(&smo::DifferentialCase::source_periods);
+  AddWithout(&smo::DifferentialCase::device_coefficients);
+  AddSmaller(&smo::DifferentialCase::buffer_capacity, 0);
+  AddSmallerValues(&smo::DifferentialCase::source_periods);
+  AddSmallerValues(&smo::DifferentialCase::device_coefficients);
+  return candidates;
+}
+
+smo::DifferentialCase smo::ShrinkCase(DifferentialCase test_case,
+                                      const AlternateEngineFactory& factory) {
+  bool has_shrunk = true;
+  while (has_shrunk) {
+    has_shrunk = false;
+    for (auto& candidate : ShrinkCandidates(test_case)) {
+      if (CompareEngines(candidate, factory).has_value()) {
+        test_case = std::move(candidate);
+        has_shrunk = true;
+        break;
+      }
+    }
+  }
+  return test_case;
+}
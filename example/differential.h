@@ -0,0 +1,78 @@
+#ifndef DIFFERENTIAL_H_
+#define DIFFERENTIAL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../smo_components.h"
+#include "simulation_results.h"
+#include "simulator.h"
+#include "simulator_config.h"
+
+namespace smo {
+// Model, that is run by both engines, kept as plain values, so that it can
+// be shrunk.
+struct DifferentialCase {
+  SimulatorConfig config() const;
+
+  std::size_t buffer_capacity = 0;
+  std::size_t target_amount_of_requests = 0;
+  std::vector<Time> source_periods;
+  std::vector<double> device_coefficients;
+  BufferDiscipline buffer_discipline = BufferDiscipline::fifo;
+  DeviceSelection device_selection = DeviceSelection::roundRobin;
+  SimulatorLaw law = SimulatorLaw::deterministic;
+  SourceArrivals arrivals = SourceArrivals::periodic;
+  std::uint64_t seed = 0;
+};
+// Engine, which is checked against Simulator. Every replication it runs
+// has to match the reference event by event.
+class AlternateEngine {
+ public:
+  virtual ~AlternateEngine() = default;
+
+  virtual std::size_t replications() const = 0;
+  // Writes the next event of every replication, or endOfSimulation once it
+  // is completed.
+  virtual void Step(std::span<SpecialEvent> events) = 0;
+  virtual SimulationResults results(std::size_t replication) const = 0;
+};
+// Kinds of models, which an engine covers. Deterministic models always have
+// periodic arrivals, so `arrivals` only applies to stochastic ones.
+struct DifferentialCoverage {
+  std::vector<BufferDiscipline> buffer_disciplines;
+  std::vector<DeviceSelection> device_selections;
+  std::vector<SimulatorLaw> laws;
+  std::vector<SourceArrivals> arrivals;
+};
+struct AlternateEngineFactory {
+  DifferentialCoverage coverage;
+  // Takes only cases within `coverage`.
+  std::function<std::unique_ptr<AlternateEngine>(const DifferentialCase&)>
+      make;
+};
+// LockstepSimulator with `lanes` lanes. It draws variates from generators
+// of its own, so only deterministic cases are comparable.
+AlternateEngineFactory LockstepEngineFactory(std::size_t lanes);
+
+// Draws only kinds of models within `coverage`. The seed is drawn only for
+// stochastic models, since it doesn't change deterministic ones.
+DifferentialCase RandomCase(const DifferentialCoverage& coverage,
+                            std::mt19937_64& random_gen);
+// Description of the first difference between Simulator and the engine,
+// which must cover the case, in events or in final statistics.
+std::optional<std::string> CompareEngines(
+    const DifferentialCase& test_case, const AlternateEngineFactory& factory);
+// Greedily removes sources, devices and requests, and makes numbers
+// smaller, while the engines still differ.
+DifferentialCase ShrinkCase(DifferentialCase test_case,
+                            const AlternateEngineFactory& factory);
+}  // namespace smo
+#endif
@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "lockstep_simulator.h"
+
+// Draws of every lane, made at once.
+static constexpr std::size_t drawBlock = 64;
+
+bool smo::LockstepSimulator::Supports(const SimulatorConfig& config,
+                                      SimulatorLaw law,
+                                      DeviceGrouping grouping,
+                                      SourceArrivals arrivals) {
+  return config.buffer_discipline == BufferDiscipline::fifo &&
+         config.device_selection == DeviceSelection::roundRobin &&
+         grouping == DeviceGrouping::individual &&
+         arrivals != SourceArrivals::mergedPoisson &&
+         (arrivals == SourceArrivals::periodic ||
+          law == SimulatorLaw::stochastic) &&
+         config.source_job_sizes.empty() && config.source_batch_sizes.empty();
+}
+
+smo::LockstepSimulator::LockstepSimulator(SimulatorConfig config,
+                                          SimulatorLaw law,
+                                          SourceArrivals arrivals,
+                                          std::size_t lanes)
+    : law_(law),
+      arrivals_(arrivals),
+      lanes_(lanes),
+      buffer_capacity_(config.buffer_capacity),
+      target_amount_of_requests_(config.target_amount_of_requests),
+      source_periods_(config.source_periods),
+      device_coefficients_(config.device_coefficients),
+      config_storage_(std::move(config.storage)) {
+  std::size_t entities = source_periods_.size() + device_coefficients_.size();
+  next_times_.resize(entities * lanes_);
+  current_times_.resize(lanes_);
+  next_event_times_.resize(lanes_);
+  next_entities_.resize(lanes_);
+  sources_.resize(source_periods_.size() * lanes_);
+  device_usage_.resize(device_coefficients_.size() * lanes_);
+  buffers_.resize(buffer_capacity_ * lanes_);
+  buffer_heads_.resize(lanes_);
+  buffer_sizes_.resize(lanes_);
+  next_devices_.resize(lanes_);
+  recieved_.resize(lanes_);
+  rejected_.resize(lanes_);
+  processed_events_.resize(lanes_);
+  generator_states_.resize(4 * lanes_);
+  exponentials_.resize(drawBlock * lanes_);
+  fractions_.resize(drawBlock * lanes_);
+  draw_positions_.resize(lanes_);
+  Seed(0);
+}
+
+// SplitMix64 stream fills the states, as recommended for xoshiro.
+void smo::LockstepSimulator::Seed(std::uint64_t seed) {
+  std::uint64_t state = seed;
+  for (std::size_t lane = 0; lane < lanes_; ++lane) {
+    for (std::size_t word = 0; word < 4; ++word) {
+      state += 0x9e3779b97f4a7c15ull;
+      auto z = state;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      generator_states_[word * lanes_ + lane] = z ^ (z >> 31);
+    }
+  }
+  RefillDraws();
+  Reset();
+}
+
+void smo::LockstepSimulator::Reset() {
+  std::fill(sources_.begin(), sources_.end(), SourceStatistics{});
+  std::fill(device_usage_.begin(), device_usage_.end(), Time(0));
+  std::fill(next_times_.begin(), next_times_.end(), maxTime);
+  for (auto* values : {&buffer_heads_, &buffer_sizes_, &next_devices_,
+                       &recieved_, &rejected_, &processed_events_}) {
+    std::fill(values->begin(), values->end(), 0);
+  }
+  std::fill(current_times_.begin(), current_times_.end(), Time(0));
+  for (std::size_t lane = 0; lane < lanes_; ++lane) {
+    for (std::size_t i = 0; i < source_periods_.size(); ++i) {
+      next_time(i, lane) = SourcePeriod(lane, i);
+    }
+  }
+}
+
+bool smo::LockstepSimulator::Step(std::span<SpecialEvent> events) {
+  PickNextEvents();
+  bool is_completed = true;
+  for (std::size_t lane = 0; lane < lanes_; ++lane) {
+    events[lane] = StepLane(lane);
+    is_completed =
+        is_completed && events[lane].kind == SpecialEventKind::endOfSimulation;
+  }
+  return !is_completed;
+}
+
+void smo::LockstepSimulator::RunToCompletion() {
+  while (true) {
+    PickNextEvents();
+    bool is_completed = true;
+    for (std::size_t lane = 0; lane < lanes_; ++lane) {
+      auto event = StepLane(lane);
+      is_completed =
+          is_completed && event.kind == SpecialEventKind::endOfSimulation;
+    }
+    if (is_completed) {
+      return;
+    }
+  }
+}
+
+// Handles the event, picked for the lane.
+smo::SpecialEvent smo::LockstepSimulator::StepLane(std::size_t lane) {
+  auto sources_amount = source_periods_.size();
+  auto entity = next_entities_[lane];
+  auto time = next_event_times_[lane];
+  if (time == maxTime) {
+    return SpecialEvent{SpecialEventKind::endOfSimulation};
+  }
+  current_times_[lane] = time;
+  processed_events_[lane] += 1;
+  if (entity < sources_amount) {
+    HandleNewRequestCreation(lane, entity);
+    return SpecialEvent{SpecialEventKind::generateNewRequest, time, entity};
+  }
+  HandleDeviceRelease(lane, entity - sources_amount);
+  return SpecialEvent{SpecialEventKind::deviceRelease, time,
+                      entity - sources_amount};
+}
+
+// Lowest entity wins ties, so a single strict comparison per entity keeps
+// the order, and the inner loop over lanes has no branches.
+void smo::LockstepSimulator::PickNextEvents() {
+  std::size_t entities = next_times_.size() / lanes_;
+  std::copy_n(next_times_.begin(), lanes_, next_event_times_.begin());
+  std::fill(next_entities_.begin(), next_entities_.end(), 0);
+  Time* times = next_event_times_.data();
+  std::size_t* next_entities = next_entities_.data();
+  for (std::size_t entity = 1; entity < entities; ++entity) {
+    const Time* entity_times = next_times_.data() + entity * lanes_;
+    for (std::size_t lane = 0; lane < lanes_; ++lane) {
+      bool is_earlier = entity_times[lane] < times[lane];
+      times[lane] = is_earlier ? entity_times[lane] : times[lane];
+      next_entities[lane] = is_earlier ? entity : next_entities[lane];
+    }
+  }
+}
+
+void smo::LockstepSimulator::HandleNewRequestCreation(std::size_t lane,
+                                                      std::size_t source_id) {
+  auto& source = sources_[source_id * lanes_ + lane];
+  auto now = current_times_[lane];
+  Request request{source_id, source.generated, now};
+  source.generated += 1;
+  recieved_[lane] += 1;
+  if (!OccupyNextDevice(lane, request)) {
+    auto& size = buffer_sizes_[lane];
+    if (size == buffer_capacity_) {
+      source.AddTimeInBuffer(0);
+      source.rejected += 1;
+      rejected_[lane] += 1;
+    } else {
+      auto slot = buffer_heads_[lane] + size;
+      if (slot >= buffer_capacity_) {
+        slot -= buffer_capacity_;
+      }
+      buffers_[lane * buffer_capacity_ + slot] = request;
+      size += 1;
+    }
+  }
+  if (recieved_[lane] >= target_amount_of_requests_) {
+    for (std::size_t i = 0; i < source_periods_.size(); ++i) {
+      next_time(i, lane) = maxTime;
+    }
+  } else {
+    next_time(source_id, lane) = now + SourcePeriod(lane, source_id);
+  }
+}
+
+void smo::LockstepSimulator::HandleDeviceRelease(std::size_t lane,
+                                                 std::size_t device_id) {
+  next_time(source_periods_.size() + device_id, lane) = maxTime;
+  auto& size = buffer_sizes_[lane];
+  if (size == 0) {
+    return;
+  }
+  auto& head = buffer_heads_[lane];
+  auto request = buffers_[lane * buffer_capacity_ + head];
+  head = head + 1 == buffer_capacity_ ? 0 : head + 1;
+  size -= 1;
+  sources_[request.source_id * lanes_ + lane].AddTimeInBuffer(
+      current_times_[lane] - request.generation_time);
+  OccupyNextDevice(lane, request);
+}
+
+// Round robin: the first idle device, starting after the last picked one.
+bool smo::LockstepSimulator::OccupyNextDevice(std::size_t lane,
+                                              const Request& request) {
+  auto devices_amount = device_coefficients_.size();
+  auto& next_device = next_devices_[lane];
+  for (std::size_t i = 0; i < devices_amount; ++i) {
+    auto device_id = next_device + i;
+    if (device_id >= devices_amount) {
+      device_id -= devices_amount;
+    }
+    auto& release_time = next_time(source_periods_.size() + device_id, lane);
+    if (release_time != maxTime) {
+      continue;
+    }
+    double mean = device_coefficients_[device_id];
+    auto processing_time =
+        law_ == SimulatorLaw::deterministic
+            ? Time(mean)
+            : Time(mean * NextDraw(lane).exponential);
+    sources_[request.source_id * lanes_ + lane].AddTimeInDevice(
+        processing_time);
+    device_usage_[device_id * lanes_ + lane] += processing_time;
+    release_time = current_times_[lane] + processing_time;
+    next_device = device_id + 1 == devices_amount ? 0 : device_id + 1;
+    return true;
+  }
+  return false;
+}
+
+smo::Time smo::LockstepSimulator::SourcePeriod(std::size_t lane,
+                                               std::size_t source_id) {
+  if (arrivals_ == SourceArrivals::periodic) {
+    return source_periods_[source_id];
+  }
+  auto draw = NextDraw(lane);
+  return Time(source_periods_[source_id] * draw.exponential + draw.fraction);
+}
+
+smo::LockstepSimulator::Draw smo::LockstepSimulator::NextDraw(
+    std::size_t lane) {
+  auto& position = draw_positions_[lane];
+  if (position == drawBlock) {
+    RefillDraws();
+  }
+  auto index = position * lanes_ + lane;
+  position += 1;
+  return Draw{exponentials_[index], fractions_[index]};
+}
+
+// Refills every lane, since they run out at about the same time. Draws
+// left unused are independent of the rest, so dropping them is harmless.
+void smo::LockstepSimulator::RefillDraws() {
+  std::uint64_t* s0 = generator_states_.data();
+  std::uint64_t* s1 = s0 + lanes_;
+  std::uint64_t* s2 = s1 + lanes_;
+  std::uint64_t* s3 = s2 + lanes_;
+  auto NextUniform = [&](std::size_t lane) {
+    auto result = s0[lane] + s3[lane];
+    auto t = s1[lane] << 17;
+    s2[lane] ^= s0[lane];
+    s3[lane] ^= s1[lane];
+    s1[lane] ^= s2[lane];
+    s0[lane] ^= s3[lane];
+    s2[lane] ^= t;
+    s3[lane] = std::rotl(s3[lane], 45);
+    return static_cast<double>(result >> 11) * 0x1.0p-53;
+  };
+  for (std::size_t i = 0; i < drawBlock; ++i) {
+    double* exponentials = exponentials_.data() + i * lanes_;
+    double* fractions = fractions_.data() + i * lanes_;
+    for (std::size_t lane = 0; lane < lanes_; ++lane) {
+      exponentials[lane] = -std::log(1.0 - NextUniform(lane));
+      fractions[lane] = NextUniform(lane);
+    }
+  }
+  std::fill(draw_positions_.begin(), draw_positions_.end(), 0);
+}
+
+smo::Time& smo::LockstepSimulator::next_time(std::size_t entity,
+                                             std::size_t lane) {
+  return next_times_[entity * lanes_ + lane];
+}
+
+std::size_t smo::LockstepSimulator::lanes() const { return lanes_; }
+
+std::size_t smo::LockstepSimulator::processed_events() const {
+  std::size_t result = 0;
+  for (auto events : processed_events_) {
+    result += events;
+  }
+  return result;
+}
+
+smo::SimulationResults smo::LockstepSimulator::lane_results(
+    std::size_t lane) const {
+  SimulationResults results;
+  results.replications = 1;
+  results.simulation_time = current_times_[lane];
+  results.recieved = recieved_[lane];
+  results.rejected = rejected_[lane];
+  for (std::size_t i = 0; i < source_periods_.size(); ++i) {
+    results.sources.push_back(sources_[i * lanes_ + lane]);
+  }
+  results.devices.resize(device_coefficients_.size());
+  for (std::size_t i = 0; i < device_coefficients_.size(); ++i) {
+    results.devices[i].time_in_usage = device_usage_[i * lanes_ + lane];
+  }
+  return results;
+}
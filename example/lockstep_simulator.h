@@ -0,0 +1,96 @@
+#ifndef LOCKSTEP_SIMULATOR_H_
+#define LOCKSTEP_SIMULATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "../smo_components.h"
+#include "simulation_results.h"
+#include "simulator.h"
+#include "simulator_config.h"
+
+namespace smo {
+// Experimental engine, which runs several independent replications of the
+// same model at once. State is laid out as structure of arrays with lanes
+// innermost, so that the next event of every lane is picked by a single
+// branchless scan over sources and devices, and random variates are drawn
+// for all lanes in blocks. Lanes diverge with their first random draw, so
+// events themselves are handled lane by lane.
+//
+// Covers the basic model only: FIFO buffer, round robin devices with
+// individual exponential or deterministic processing times, periodic or
+// Poisson sources, single requests without job sizes. The scan is linear
+// in sources and devices, so it pays off for small models.
+class LockstepSimulator {
+ public:
+  static bool Supports(const SimulatorConfig& config, SimulatorLaw law,
+                       DeviceGrouping grouping, SourceArrivals arrivals);
+  LockstepSimulator(SimulatorConfig config, SimulatorLaw law,
+                    SourceArrivals arrivals, std::size_t lanes);
+
+  // Every lane draws from a generator of its own, all seeded by `seed`.
+  // Resets the simulation.
+  void Seed(std::uint64_t seed);
+  void Reset();
+  // Processes the next event of every lane, and writes them to `events`,
+  // which has a place per lane. Completed lanes get endOfSimulation.
+  // Returns false, once every lane is completed.
+  bool Step(std::span<SpecialEvent> events);
+  void RunToCompletion();
+  std::size_t lanes() const;
+  // Summed over lanes.
+  std::size_t processed_events() const;
+  SimulationResults lane_results(std::size_t lane) const;
+
+ private:
+  // Pair of variates, drawn by a lane at once.
+  struct Draw {
+    double exponential;
+    double fraction;
+  };
+  void PickNextEvents();
+  SpecialEvent StepLane(std::size_t lane);
+  void HandleNewRequestCreation(std::size_t lane, std::size_t source_id);
+  void HandleDeviceRelease(std::size_t lane, std::size_t device_id);
+  bool OccupyNextDevice(std::size_t lane, const Request& request);
+  Time SourcePeriod(std::size_t lane, std::size_t source_id);
+  Draw NextDraw(std::size_t lane);
+  void RefillDraws();
+  Time& next_time(std::size_t entity, std::size_t lane);
+
+  SimulatorLaw law_;
+  SourceArrivals arrivals_;
+  std::size_t lanes_;
+  std::size_t buffer_capacity_;
+  std::size_t target_amount_of_requests_;
+  std::span<const smo::Time> source_periods_;
+  std::span<const double> device_coefficients_;
+  std::shared_ptr<const void> config_storage_;
+  // Sources come first, then devices, which matches the order of
+  // simultaneous events in SimulatorBase. Idle devices have maxTime.
+  std::vector<Time> next_times_;
+  std::vector<Time> current_times_;
+  // Earliest event of each lane, picked by the scan.
+  std::vector<Time> next_event_times_;
+  std::vector<std::size_t> next_entities_;
+  std::vector<SourceStatistics> sources_;
+  std::vector<Time> device_usage_;
+  // Ring buffer of each lane.
+  std::vector<Request> buffers_;
+  std::vector<std::size_t> buffer_heads_;
+  std::vector<std::size_t> buffer_sizes_;
+  std::vector<std::size_t> next_devices_;
+  std::vector<std::size_t> recieved_;
+  std::vector<std::size_t> rejected_;
+  std::vector<std::size_t> processed_events_;
+  // Xoshiro256+ states, one word of every lane after another.
+  std::vector<std::uint64_t> generator_states_;
+  std::vector<double> exponentials_;
+  std::vector<double> fractions_;
+  std::vector<std::size_t> draw_positions_;
+};
+}  // namespace smo
+#endif
@@ -1,20 +1,51 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <optional>
 #include <ostream>
+#include <random>
+#include <span>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "../counting_resource.h"
+#include "../network.h"
+#include "../progress_channel.h"
 #include "arguments_parser.h"
+#include "capacity_search.h"
+#include "differential.h"
+#include "lockstep_simulator.h"
 #include "print.h"
+#include "report_writers.h"
+#include "result_cache.h"
 #include "return_codes.h"
+#include "simulation_results.h"
 #include "simulator.h"
 #include "simulator_config.h"
+#include "trace.h"
 
 double CalculateNextTargetAmountOfRequests(double rejection_probability);
+bool HasValuePerSource(const smo::SimulatorConfig& config,
+                       std::span<const double> values);
+void RunWithProgress(smo::Simulator& simulator);
+void RunBenchmark(smo::Simulator& simulator, std::size_t cycles,
+                  const smo::CountingMemoryResource& memory_resource);
+void RunLockstepBenchmark(const smo::SimulatorConfig& config,
+                          const parse::Arguments& args);
+codes::Result RunDifferentialTesting(const parse::Arguments& args);
+codes::Result RunNetworkCheck(const parse::Arguments& args);
+smo::SimulationResults RunReplications(smo::Simulator& simulator,
+                                       const parse::Arguments& args,
+                                       smo::ResultCache* cache,
+                                       const std::string& model_key);
 int main(int argc, char** argv) {
   parse::Arguments args;
   auto parse_result = args.Parse(argc, argv);
@@ -22,18 +53,111 @@ int main(int argc, char** argv) {
     smo::PrintUsage(std::cerr);
     return parse_result;
   }
+  if (args.mode == parse::SimulationMode::differentialTesting) {
+    return RunDifferentialTesting(args);
+  }
+  if (args.mode == parse::SimulationMode::networkCheck) {
+    return RunNetworkCheck(args);
+  }
   smo::SimulatorConfig config;
-  args.input_file >> config;
-  if (!std::cin || config.buffer_capacity < 0 ||
+  if (!smo::ReadSimulatorConfig(args.input_path, config) ||
       config.device_coefficients.size() == 0 ||
       config.source_periods.size() == 0 ||
-      config.target_amount_of_requests <= 0) {
+      config.target_amount_of_requests <= 0 ||
+      !HasValuePerSource(config, config.source_weights) ||
+      !HasValuePerSource(config, config.source_job_sizes) ||
+      !HasValuePerSource(config, config.source_batch_sizes) ||
+      std::any_of(config.source_batch_sizes.begin(),
+                  config.source_batch_sizes.end(),
+                  [](double size) { return size < 1; })) {
     return codes::configError;
   }
-  smo::Simulator simulator(std::move(config), args.law);
+  if (args.binary_config_file.has_value()) {
+    smo::WriteBinaryConfig(*args.binary_config_file, config);
+    return codes::success;
+  }
+  bool is_deterministic = args.law == smo::SimulatorLaw::deterministic;
+  bool is_aggregated =
+      args.device_grouping == smo::DeviceGrouping::aggregated;
+  if ((is_aggregated && (is_deterministic || !config.source_job_sizes.empty() ||
+                         args.service_trace_path.has_value())) ||
+      (args.source_arrivals != smo::SourceArrivals::periodic &&
+       is_deterministic) ||
+      (args.source_arrivals == smo::SourceArrivals::mergedPoisson &&
+       args.arrival_trace_path.has_value()) ||
+      (args.cache_path.has_value() &&
+       (!args.seed.has_value() || args.estimate_gradients ||
+        args.arrival_trace_path.has_value() ||
+        args.service_trace_path.has_value())) ||
+      (args.replications > 1 &&
+       args.mode != parse::SimulationMode::runToCompletion) ||
+      (args.seed.has_value() &&
+       args.mode != parse::SimulationMode::runToCompletion &&
+       args.mode != parse::SimulationMode::capacitySearch &&
+       args.mode != parse::SimulationMode::lockstepBenchmark) ||
+      ((args.mode == parse::SimulationMode::capacitySearch ||
+        args.mode == parse::SimulationMode::lockstepBenchmark) &&
+       (args.cache_path.has_value() || args.estimate_gradients ||
+        args.arrival_trace_path.has_value() ||
+        args.service_trace_path.has_value())) ||
+      (args.mode == parse::SimulationMode::lockstepBenchmark &&
+       !smo::LockstepSimulator::Supports(config, args.law,
+                                         args.device_grouping,
+                                         args.source_arrivals))) {
+    smo::PrintUsage(std::cerr);
+    return codes::invalidArguments;
+  }
+  if (args.mode == parse::SimulationMode::capacitySearch) {
+    smo::ServiceLevel level{.max_rejection_probability =
+                                args.max_rejection_probability,
+                            .max_wait = args.max_wait};
+    smo::CapacitySearchOptions options{.law = args.law,
+                                       .grouping = args.device_grouping,
+                                       .arrivals = args.source_arrivals,
+                                       .seed = args.seed.value_or(0)};
+    smo::PrintCapacitySearch(std::cout,
+                             smo::SearchCapacity(config, level, options));
+    return codes::success;
+  }
+  if (args.mode == parse::SimulationMode::lockstepBenchmark) {
+    RunLockstepBenchmark(config, args);
+    return codes::success;
+  }
+  std::shared_ptr<const smo::Trace> arrival_trace;
+  std::shared_ptr<const smo::Trace> service_trace;
+  if (args.arrival_trace_path.has_value()) {
+    arrival_trace = smo::Trace::Open(*args.arrival_trace_path);
+    if (arrival_trace == nullptr) {
+      return codes::configError;
+    }
+  }
+  if (args.service_trace_path.has_value()) {
+    service_trace = smo::Trace::Open(*args.service_trace_path);
+    if (service_trace == nullptr) {
+      return codes::configError;
+    }
+  }
+  std::unique_ptr<smo::ResultCache> cache;
+  std::string model_key;
+  if (args.cache_path.has_value()) {
+    cache = smo::ResultCache::Open(*args.cache_path);
+    if (cache == nullptr) {
+      return codes::cacheError;
+    }
+    model_key = smo::ModelKey(config, args.law, args.device_grouping,
+                              args.source_arrivals);
+  }
+  smo::CountingMemoryResource memory_resource;
+  smo::Simulator simulator(std::move(config), args.law, args.device_grouping,
+                           args.source_arrivals, &memory_resource);
+  if (arrival_trace != nullptr || service_trace != nullptr) {
+    simulator.UseTraces(std::move(arrival_trace), std::move(service_trace));
+  }
+  simulator.EnableGradientEstimation(args.estimate_gradients);
+  std::optional<smo::SimulationResults> results;
   switch (args.mode) {
     case parse::SimulationMode::runToCompletion:
-      simulator.RunToCompletion();
+      results = RunReplications(simulator, args, cache.get(), model_key);
       break;
     case parse::SimulationMode::interactive: {
       std::cout << "Interactive mode. Input h to get help\n\n";
@@ -95,12 +219,34 @@ int main(int argc, char** argv) {
       }
       break;
     }
+    case parse::SimulationMode::benchmark:
+      RunBenchmark(simulator, args.benchmark_cycles, memory_resource);
+      break;
+    case parse::SimulationMode::capacitySearch:
+    case parse::SimulationMode::lockstepBenchmark:
+    case parse::SimulationMode::differentialTesting:
+    case parse::SimulationMode::networkCheck:
+      break;
+  }
+  if (!results.has_value()) {
+    results = smo::CollectResults(simulator);
   }
   if (args.need_output) {
-    if (args.report_file.has_value()) {
-      smo::PrintReport(*args.report_file, simulator);
-    } else {
-      smo::PrintReport(std::cout, simulator);
+    std::ostream& out =
+        args.report_file.has_value() ? *args.report_file : std::cout;
+    switch (args.report_format) {
+      case parse::ReportFormat::table:
+        smo::PrintReport(out, *results);
+        break;
+      case parse::ReportFormat::csv:
+        smo::WriteCsvReport(out, *results);
+        break;
+      case parse::ReportFormat::jsonLines:
+        smo::WriteJsonLinesReport(out, *results);
+        break;
+      case parse::ReportFormat::binary:
+        smo::WriteBinaryReport(out, *results);
+        break;
     }
   }
 }
@@ -111,3 +257,249 @@ double CalculateNextTargetAmountOfRequests(double rejection_probability) {
   const double p = rejection_probability;
   return (t_a * t_a * (1 - p)) / (p * delta * delta);
 }
+
+// Optional per source values are either absent, or positive for every source.
+bool HasValuePerSource(const smo::SimulatorConfig& config,
+                       std::span<const double> values) {
+  if (values.empty()) {
+    return true;
+  }
+  return values.size() == config.source_periods.size() &&
+         std::all_of(values.begin(), values.end(),
+                     [](double value) { return value > 0; });
+}
+
+void RunWithProgress(smo::Simulator& simulator) {
+  const std::size_t publishing_period = 1 << 14;
+  const auto refresh_period = std::chrono::milliseconds(200);
+  smo::ProgressChannel channel(simulator.device_statistics().size());
+  simulator.AttachProgressChannel(&channel, publishing_period);
+  std::atomic<bool> is_running{true};
+  std::thread monitor([&] {
+    smo::ProgressSnapshot snapshot;
+    while (is_running.load(std::memory_order_relaxed)) {
+      if (channel.Read(snapshot)) {
+        smo::PrintProgress(std::cerr, snapshot);
+      }
+      std::this_thread::sleep_for(refresh_period);
+    }
+    if (channel.Read(snapshot)) {
+      smo::PrintProgress(std::cerr, snapshot);
+    }
+    std::cerr << '\n';
+  });
+  simulator.RunToCompletion();
+  is_running.store(false, std::memory_order_relaxed);
+  monitor.join();
+  simulator.AttachProgressChannel(nullptr, 0);
+}
+
+// Replications use consecutive seeds, starting from the given one. Cached
+// ones aren't simulated again, and new ones are stored.
+smo::SimulationResults RunReplications(smo::Simulator& simulator,
+                                       const parse::Arguments& args,
+                                       smo::ResultCache* cache,
+                                       const std::string& model_key) {
+  smo::SimulationResults total;
+  for (std::size_t i = 0; i < args.replications; ++i) {
+    std::optional<smo::SimulationResults> results;
+    std::uint64_t seed = args.seed.value_or(0) + i;
+    if (cache != nullptr) {
+      results = cache->Find(model_key, seed);
+    }
+    if (!results.has_value()) {
+      if (args.seed.has_value()) {
+        simulator.Seed(seed);
+      } else if (i > 0) {
+        simulator.Reset();
+      }
+      if (args.show_progress) {
+        RunWithProgress(simulator);
+      } else {
+        simulator.RunToCompletion();
+      }
+      results = smo::CollectResults(simulator);
+      if (cache != nullptr) {
+        cache->Store(model_key, seed, *results);
+      }
+    }
+    smo::MergeResults(total, *results);
+  }
+  return total;
+}
+
+// Measures repeated reset and run cycles, as done by `-a` mode and sweeps.
+// Allocations of the simulator are counted after the first cycle, when its
+// containers have grown to their steady state size.
+void RunBenchmark(smo::Simulator& simulator, std::size_t cycles,
+                  const smo::CountingMemoryResource& memory_resource) {
+  using Clock = std::chrono::steady_clock;
+  Clock::duration reset_time{0};
+  Clock::duration run_time{0};
+  std::size_t steady_allocations = 0;
+  std::size_t steady_events = 0;
+  for (std::size_t i = 0; i < cycles; ++i) {
+    auto allocations = memory_resource.allocations();
+    auto reset_start = Clock::now();
+    simulator.Reset();
+    auto run_start = Clock::now();
+    simulator.RunToCompletion();
+    auto run_end = Clock::now();
+    reset_time += run_start - reset_start;
+    run_time += run_end - run_start;
+    if (i > 0) {
+      steady_allocations += memory_resource.allocations() - allocations;
+      steady_events += simulator.processed_events();
+    }
+  }
+  auto AverageMicroseconds = [cycles](Clock::duration time) {
+    return std::chrono::duration<double, std::micro>(time).count() / cycles;
+  };
+  std::cout << "Cycles: " << cycles << '\n';
+  std::cout << "Average reset time: " << AverageMicroseconds(reset_time)
+            << " us\n";
+  std::cout << "Average run time: " << AverageMicroseconds(run_time)
+            << " us\n";
+  if (steady_events != 0) {
+    std::cout << "Allocations per event after the first cycle: "
+              << static_cast<double>(steady_allocations) / steady_events
+              << '\n';
+  }
+}
+
+// Runs the same replications in lockstep and one by one. Statistics of both
+// are pooled and printed side by side, as a sanity check.
+void RunLockstepBenchmark(const smo::SimulatorConfig& config,
+                          const parse::Arguments& args) {
+  using Clock = std::chrono::steady_clock;
+  std::uint64_t seed = args.seed.value_or(0);
+  smo::LockstepSimulator lockstep(config, args.law, args.source_arrivals,
+                                  args.lanes);
+  lockstep.Seed(seed);
+  auto lockstep_start = Clock::now();
+  lockstep.RunToCompletion();
+  Clock::duration lockstep_time = Clock::now() - lockstep_start;
+  smo::SimulationResults lockstep_results;
+  for (std::size_t lane = 0; lane < args.lanes; ++lane) {
+    smo::MergeResults(lockstep_results, lockstep.lane_results(lane));
+  }
+
+  std::vector<std::unique_ptr<smo::Simulator>> simulators;
+  for (std::size_t i = 0; i < args.lanes; ++i) {
+    simulators.push_back(std::make_unique<smo::Simulator>(
+        config, args.law, args.device_grouping, args.source_arrivals));
+    simulators.back()->Seed(seed + i);
+  }
+  auto serial_start = Clock::now();
+  for (auto& simulator : simulators) {
+    simulator->RunToCompletion();
+  }
+  Clock::duration serial_time = Clock::now() - serial_start;
+  smo::SimulationResults serial_results;
+  std::size_t serial_events = 0;
+  for (const auto& simulator : simulators) {
+    smo::MergeResults(serial_results, smo::CollectResults(*simulator));
+    serial_events += simulator->processed_events();
+  }
+
+  auto Print = [](const char* name, Clock::duration time, std::size_t events,
+                  const smo::SimulationResults& results) {
+    double seconds = std::chrono::duration<double>(time).count();
+    std::cout << name << " time: " << seconds * 1e3 << " ms, "
+              << events / seconds << " events/s, rejection probability: "
+              << static_cast<double>(results.rejected) / results.recieved
+              << '\n';
+  };
+  std::cout << "Lanes: " << args.lanes << '\n';
+  Print("Lockstep", lockstep_time, lockstep.processed_events(),
+        lockstep_results);
+  Print("Serial", serial_time, serial_events, serial_results);
+  std::cout << "Speedup: "
+            << std::chrono::duration<double>(serial_time) / lockstep_time
+            << '\n';
+}
+
+// Compares the lockstep engine against Simulator on random cases, and
+// shrinks the first differing one.
+codes::Result RunDifferentialTesting(const parse::Arguments& args) {
+  const std::size_t lanes = 4;
+  std::mt19937_64 random_gen(args.seed.value_or(0));
+  auto factory = smo::LockstepEngineFactory(lanes);
+  for (std::size_t i = 0; i < args.differential_cases; ++i) {
+    auto test_case = smo::RandomCase(factory.coverage, random_gen);
+    if (smo::CompareEngines(test_case, factory).has_value()) {
+      auto shrunk_case = smo::ShrinkCase(std::move(test_case), factory);
+      std::cout << "Mismatch: " << *smo::CompareEngines(shrunk_case, factory)
+                << '\n';
+      std::cout << "Shrunk case, ";
+      if (shrunk_case.law == smo::SimulatorLaw::deterministic) {
+        std::cout << "deterministic law:\n";
+      } else {
+        std::cout << "stochastic law, "
+                  << (shrunk_case.arrivals == smo::SourceArrivals::periodic
+                          ? "periodic"
+                          : "poisson")
+                  << " arrivals, seed " << shrunk_case.seed << ":\n";
+      }
+      std::cout << shrunk_case.config();
+      return codes::engineMismatch;
+    }
+  }
+  std::cout << "Compared cases: " << args.differential_cases << '\n';
+  return codes::success;
+}
+
+// Runs a network of `stations` with 1, 2, 4 and 8 threads, and checks, that
+// every run gives the statistics of the sequential one. Every fourth station
+// has external sources, served requests go one and seven stations ahead.
+codes::Result RunNetworkCheck(const parse::Arguments& args) {
+  using Clock = std::chrono::steady_clock;
+  const smo::Time end_time = 20'000;
+  std::size_t stations = args.network_stations;
+  std::vector<smo::NetworkNodeConfig> nodes(stations);
+  for (std::size_t i = 0; i < stations; ++i) {
+    auto& node = nodes[i];
+    if (i % 4 == 0) {
+      node.source_periods = {7, 11};
+    }
+    node.device_coefficients = {10, 12, 15};
+    node.buffer_capacity = 5;
+    node.routes = {{(i + 1) % stations, 0.5}, {(i + 7) % stations, 0.3}};
+    node.transfer_delay = 3 + i % 3;
+  }
+  smo::Network network(std::move(nodes), end_time, args.seed.value_or(0));
+
+  std::vector<smo::NetworkNodeStatistics> expected;
+  std::vector<smo::Time> expected_usage;
+  for (std::size_t threads_amount : {1, 2, 4, 8}) {
+    network.Reset();
+    auto start = Clock::now();
+    network.Run(threads_amount);
+    Clock::duration time = Clock::now() - start;
+    std::vector<smo::NetworkNodeStatistics> statistics;
+    std::vector<smo::Time> usage;
+    for (std::size_t i = 0; i < network.nodes_amount(); ++i) {
+      const auto& node = network.node(i);
+      statistics.push_back(node.statistics());
+      for (const auto& device : node.device_statistics()) {
+        usage.push_back(device.time_in_usage);
+      }
+    }
+    std::cout << "Threads: " << threads_amount << ", run time: "
+              << std::chrono::duration<double, std::milli>(time).count()
+              << " ms\n";
+    if (threads_amount == 1) {
+      expected = std::move(statistics);
+      expected_usage = std::move(usage);
+    } else if (statistics != expected || usage != expected_usage) {
+      std::cout << "Statistics differ from the sequential run\n";
+      return codes::engineMismatch;
+    }
+  }
+  std::size_t served = 0;
+  for (const auto& node : expected) {
+    served += node.served;
+  }
+  std::cout << "Statistics match, served requests: " << served << '\n';
+  return codes::success;
+}
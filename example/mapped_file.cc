@@ -0,0 +1,68 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "mapped_file.h"
+
+std::shared_ptr<const smo::MappedFile> smo::MappedFile::Open(
+    const std::string& path) {
+  int descriptor = ::open(path.c_str(), O_RDONLY);
+  if (descriptor == -1) {
+    return nullptr;
+  }
+  struct stat status;
+  if (::fstat(descriptor, &status) == -1) {
+    ::close(descriptor);
+    return nullptr;
+  }
+  std::size_t size = status.st_size;
+  const char* data = nullptr;
+  if (size != 0) {
+    void* mapping =
+        ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (mapping == MAP_FAILED) {
+      ::close(descriptor);
+      return nullptr;
+    }
+    data = static_cast<const char*>(mapping);
+  }
+  ::close(descriptor);
+  return std::shared_ptr<const MappedFile>(new MappedFile(data, size));
+}
+
+smo::MappedFile::MappedFile(const char* data, std::size_t size)
+    : data_(data), size_(size) {}
+
+smo::MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+void smo::MappedFile::AdviseSequential() const {
+  if (data_ != nullptr) {
+    ::madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+  }
+}
+
+void smo::MappedFile::AdviseWillNeed(const char* begin,
+                                     std::size_t length) const {
+  // Advice has to start at the page boundary.
+  static const std::size_t pageSize = ::sysconf(_SC_PAGESIZE);
+  std::size_t offset = begin - data_;
+  std::size_t aligned_offset = offset - offset % pageSize;
+  if (data_ == nullptr || aligned_offset >= size_) {
+    return;
+  }
+  length = std::min(length + (offset - aligned_offset), size_ - aligned_offset);
+  ::madvise(const_cast<char*>(data_) + aligned_offset, length, MADV_WILLNEED);
+}
+
+const char* smo::MappedFile::data() const { return data_; }
+std::size_t smo::MappedFile::size() const { return size_; }
@@ -0,0 +1,32 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace smo {
+// Read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  // Returns nullptr if the file can't be opened or mapped.
+  static std::shared_ptr<const MappedFile> Open(const std::string& path);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  // Hints, that the file will be read from the beginning to the end.
+  void AdviseSequential() const;
+  // Hints, that the range of the file will be read soon.
+  void AdviseWillNeed(const char* begin, std::size_t length) const;
+  const char* data() const;
+  std::size_t size() const;
+
+ private:
+  MappedFile(const char* data, std::size_t size);
+
+  const char* data_;
+  std::size_t size_;
+};
+}  // namespace smo
+#endif
@@ -10,8 +10,14 @@
 #include "print.h"
 
 void smo::PrintUsage(std::ostream& out) {
-  out << "Usage: simulator [-i|-a] [-d] [-o [outfile]] [-m max_requests] "
+  out << "Usage: simulator "
+         "[-i|-a|-b cycles|-O max_rejection max_wait|-L lanes] [-d|-g] "
+         "[-s periodic|poisson|merged] [-A arrival_trace] [-S service_trace] "
+         "[-G] [-r seed] [-R replications] [-C cache_dir] [-p] [-o [outfile]] "
+         "[-f table|csv|jsonl|binary] [-c binary_config] [-m max_requests] "
          "infile\n";
+  out << "       simulator -D cases [-r seed]\n";
+  out << "       simulator -N stations [-r seed]\n";
 }
 void smo::PrintHelp(std::ostream& out) {
   out << "Interactive mode comands:\n";
@@ -29,6 +35,9 @@ void smo::PrintEvent(std::ostream& out, const smo::SpecialEvent& event) {
     case smo::SpecialEventKind::deviceRelease:
       out << "Device " << event.id << " is released";
       break;
+    case smo::SpecialEventKind::deviceClassRelease:
+      out << "Device of class " << event.id << " is released";
+      break;
     case smo::SpecialEventKind::endOfSimulation:
       out << "Simulation ended";
       break;
@@ -36,19 +45,73 @@ void smo::PrintEvent(std::ostream& out, const smo::SpecialEvent& event) {
   out << '\n';
 }
 
+void smo::PrintProgress(std::ostream& out,
+                        const smo::ProgressSnapshot& snapshot) {
+  out << "\rProgress: " << snapshot.Progress() * 100 << "%"
+      << " Time: " << snapshot.simulation_time
+      << " Rejection: " << snapshot.RejectionProbability();
+  // Aggregated devices are not tracked one by one.
+  if (!snapshot.device_utilization.empty()) {
+    double utilization = 0.0;
+    for (double device_utilization : snapshot.device_utilization) {
+      utilization += device_utilization;
+    }
+    utilization /= snapshot.device_utilization.size();
+    out << " Average usage: " << utilization;
+  }
+  out << std::flush;
+}
+
+template <typename... T>
+static tabulate::Table::Row_t Stringify(T&&... args);
+void smo::PrintCapacitySearch(std::ostream& out,
+                              const smo::CapacitySearchResult& result) {
+  tabulate::Table table;
+  table.add_row({"Devices", "Buffer\ncapacity", "Rejection\nprobability",
+                 "Late\nshare", "Requests", "Stopped\nearly", "Meets\nlevel"});
+  std::size_t simulated_requests = 0;
+  for (const auto& point : result.evaluated) {
+    auto row = Stringify(point.devices, point.buffer_capacity,
+                         point.rejection_probability, point.late_share,
+                         point.simulated_requests);
+    row.push_back(point.is_stopped_early ? "yes" : "no");
+    row.push_back(point.meets_rejection && point.meets_wait ? "yes" : "no");
+    table.add_row(row);
+    simulated_requests += point.simulated_requests;
+  }
+  out << table << '\n';
+  out << "Simulated requests: " << simulated_requests << '\n';
+  if (result.minimum.has_value()) {
+    out << "Least devices: " << result.minimum->devices
+        << " Least buffer capacity: " << result.minimum->buffer_capacity
+        << '\n';
+  } else {
+    out << "No candidate meets the service level\n";
+  }
+}
+
 static void PrintGeneralReport(std::ostream& out,
-                               const smo::Simulator& simulator);
+                               const smo::SimulationResults& results);
 static void PrintSourceReport(std::ostream& out,
-                              const smo::Simulator& simulator);
+                              const smo::SimulationResults& results);
 static void PrintDeviceReport(std::ostream& out,
-                              const smo::Simulator& simulator);
-void smo::PrintReport(std::ostream& out, const smo::Simulator& simulator) {
+                              const smo::SimulationResults& results);
+static void PrintGradients(std::ostream& out,
+                           const smo::GradientEstimates& gradients);
+void smo::PrintReport(std::ostream& out,
+                      const smo::SimulationResults& results) {
   out << "Report:\n";
-  PrintGeneralReport(out, simulator);
+  PrintGeneralReport(out, results);
   out << "Sources:\n";
-  PrintSourceReport(out, simulator);
+  PrintSourceReport(out, results);
   out << "Devices:\n";
-  PrintDeviceReport(out, simulator);
+  PrintDeviceReport(out, results);
+  const auto& gradients = results.gradients;
+  if (!gradients.sojourn_by_device_coefficient.empty() ||
+      !gradients.rejection_by_source_period.empty()) {
+    out << "Gradients:\n";
+    PrintGradients(out, gradients);
+  }
 }
 
 static tabulate::Table SourceCalendar(const smo::Simulator& simulator);
@@ -72,8 +135,8 @@ static std::string FormatRequest(const std::optional<smo::Request>& req);
 void smo::PrintRealBuffer(std::ostream& out, const smo::Simulator& simulator) {
   const auto& real_buffer = simulator.RealBuffer();
   std::size_t max_size = 0;
-  for (const auto& subbuffer : real_buffer) {
-    max_size = std::max(max_size, subbuffer.size());
+  for (std::size_t i = 0; i < real_buffer.packets_amount(); ++i) {
+    max_size = std::max(max_size, real_buffer.Packet(i).size());
   }
 
   tabulate::Table table;
@@ -83,17 +146,18 @@ void smo::PrintRealBuffer(std::ostream& out, const smo::Simulator& simulator) {
     index_row.push_back(std::to_string(i));
   }
   table.add_row(index_row);
-  for (std::size_t i = 0; i < real_buffer.size(); ++i) {
+  for (std::size_t i = 0; i < real_buffer.packets_amount(); ++i) {
     tabulate::Table::Row_t value_row;
     value_row.push_back("Packet " + std::to_string(i) + ":");
-    for (const auto& req : real_buffer[i]) {
+    for (const auto& req : real_buffer.Packet(i)) {
       value_row.push_back(FormatRequest(req));
     }
     table.add_row(value_row);
   }
-  std::size_t current_packet = simulator.current_packet();
-  if (!simulator.RealBuffer()[current_packet].empty()) {
-    auto& current_packet_row = table[current_packet + 1];
+  auto current_packet = simulator.current_packet();
+  if (current_packet.has_value() &&
+      !real_buffer.Packet(*current_packet).empty()) {
+    auto& current_packet_row = table[*current_packet + 1];
     for (std::size_t i = 1; i < current_packet_row.size(); ++i) {
       current_packet_row[i].format().font_style(highlight);
     }
@@ -107,26 +171,26 @@ static tabulate::Table::Row_t Stringify(T&&... args) {
 }
 
 static void PrintGeneralReport(std::ostream& out,
-                               const smo::Simulator& simulator) {
+                               const smo::SimulationResults& results) {
   tabulate::Table table;
   table.add_row({"Total\nsimulation\ntime", "Requests\nrecieved",
                  "Requests\nprocessed", "Requests\nrejected",
                  "Rejection\nprobability"});
-  std::size_t recieved = simulator.current_amount_of_requests();
-  std::size_t rejected = simulator.rejected_amount();
-  table.add_row(Stringify(simulator.current_simulation_time(), recieved,
+  std::size_t recieved = results.recieved;
+  std::size_t rejected = results.rejected;
+  table.add_row(Stringify(results.simulation_time, recieved,
                           recieved - rejected, rejected,
                           static_cast<double>(rejected) / recieved));
   out << table << '\n';
 }
 
 static void PrintSourceReport(std::ostream& out,
-                              const smo::Simulator& simulator) {
+                              const smo::SimulationResults& results) {
   tabulate::Table table;
   table.add_row({"i", "Request\namount", "Rejection\nprobability", "Time\nfull",
                  "Time\nbuffer", "Time\nprocessing", "Variance\nbuffer",
                  "Variance\nprocessing"});
-  const auto& sources = simulator.source_statistics();
+  const auto& sources = results.sources;
   for (std::size_t i = 0; i < sources.size(); ++i) {
     const auto& source = sources[i];
     auto buffer_time = source.AverageBufferTime();
@@ -141,15 +205,47 @@ static void PrintSourceReport(std::ostream& out,
 }
 
 static void PrintDeviceReport(std::ostream& out,
-                              const smo::Simulator& simulator) {
+                              const smo::SimulationResults& results) {
+  const auto& classes = results.device_classes;
+  if (!classes.empty()) {
+    tabulate::Table table;
+    table.add_row({"Class", "Devices", "Usage\ncoefficient"});
+    for (std::size_t i = 0; i < classes.size(); ++i) {
+      table.add_row(Stringify(
+          i, classes[i].size,
+          classes[i].UsageCoefficient(results.simulation_time)));
+    }
+    out << table << '\n';
+    return;
+  }
   tabulate::Table table;
   table.add_row({"i", "Usage\ncoefficient"});
-  const auto& devices = simulator.device_statistics();
+  const auto& devices = results.devices;
   for (std::size_t i = 0; i < devices.size(); ++i) {
     const auto& device = devices[i];
     table.add_row(Stringify(i, static_cast<double>(device.time_in_usage) /
-                                   simulator.current_simulation_time()));
+                                   results.simulation_time));
+  }
+  out << table << '\n';
+}
+
+static void PrintGradients(std::ostream& out,
+                           const smo::GradientEstimates& gradients) {
+  tabulate::Table sources;
+  sources.add_row({"Source", "d(Rejection)\n/d(Period)"});
+  for (std::size_t i = 0; i < gradients.rejection_by_source_period.size();
+       ++i) {
+    sources.add_row(Stringify(i, gradients.rejection_by_source_period[i]));
   }
+  tabulate::Table devices;
+  devices.add_row({"Device", "d(Time full)\n/d(Coefficient)"});
+  for (std::size_t i = 0; i < gradients.sojourn_by_device_coefficient.size();
+       ++i) {
+    devices.add_row(Stringify(i, gradients.sojourn_by_device_coefficient[i]));
+  }
+  tabulate::Table table;
+  table.add_row({sources, devices});
+  table.format().hide_border().padding(0).padding_right(1);
   out << table << '\n';
 }
 
@@ -175,6 +271,19 @@ static tabulate::Table SourceCalendar(const smo::Simulator& simulator) {
   return table;
 }
 static tabulate::Table DeviceCalendar(const smo::Simulator& simulator) {
+  const auto& classes = simulator.device_class_statistics();
+  if (!classes.empty()) {
+    tabulate::Table table;
+    table.add_row({"Class", "Next event", "Sign", "Busy"});
+    for (std::size_t i = 0; i < classes.size(); ++i) {
+      tabulate::Table::Row_t row{std::to_string(i)};
+      PushBackTimeAndSign(row, classes[i].next_request);
+      row.push_back(std::to_string(classes[i].busy) + "/" +
+                    std::to_string(classes[i].size));
+      table.add_row(row);
+    }
+    return table;
+  }
   tabulate::Table table;
   table.add_row({"i", "Next event", "Sign", "Request"});
   const auto& devices = simulator.device_statistics();
@@ -193,22 +302,22 @@ static void PrintFakeBuffer(std::ostream& out,
   tabulate::Table::Row_t index_row;
   tabulate::Table::Row_t value_row;
 
-  std::size_t current_packet = simulator.current_packet();
+  auto current_packet = simulator.current_packet();
   std::vector<std::size_t> cells_to_highlight;
 
   index_row.push_back("i:");
   value_row.push_back("Values:");
 
-  auto fake_buffer = simulator.FakeBuffer();
-  for (std::size_t i = 0; i < fake_buffer.size(); ++i) {
+  std::size_t i = 0;
+  for (const auto& request : simulator.FakeBuffer()) {
     index_row.push_back(std::to_string(i));
-    auto& request = fake_buffer[i];
     if (request.source_id == current_packet) {
       cells_to_highlight.push_back(i);
     }
     value_row.push_back(FormatRequest(request));
+    ++i;
   }
-  for (std::size_t i = fake_buffer.size(); i < fake_buffer.capacity(); ++i) {
+  for (; i < simulator.RealBuffer().capacity(); ++i) {
     index_row.push_back(std::to_string(i));
     value_row.push_back(FormatRequest(std::nullopt));
   }
@@ -3,6 +3,9 @@
 
 #include <iosfwd>
 
+#include "../progress_channel.h"
+#include "capacity_search.h"
+#include "simulation_results.h"
 #include "simulator.h"
 
 namespace smo {
@@ -10,8 +13,11 @@ void PrintUsage(std::ostream& out);
 void PrintHelp(std::ostream& out);
 void PrintEvent(std::ostream& out, const smo::SpecialEvent& event);
 void PrintSimulationState(std::ostream& out, const smo::Simulator& simulator);
-void PrintReport(std::ostream& out, const smo::Simulator& simulator);
+void PrintReport(std::ostream& out, const smo::SimulationResults& results);
 void PrintRealBuffer(std::ostream& out, const smo::Simulator& simulator);
+void PrintProgress(std::ostream& out, const smo::ProgressSnapshot& snapshot);
+void PrintCapacitySearch(std::ostream& out,
+                         const smo::CapacitySearchResult& result);
 }  // namespace smo
 
 #endif
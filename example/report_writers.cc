@@ -0,0 +1,313 @@
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "report_writers.h"
+
+namespace {
+// Accumulates output in a fixed buffer, so that the stream is touched once
+// per few kilobytes instead of once per value.
+class StreamWriter {
+ public:
+  explicit StreamWriter(std::ostream& out) : out_(out) {}
+  StreamWriter(const StreamWriter&) = delete;
+  StreamWriter& operator=(const StreamWriter&) = delete;
+  ~StreamWriter() { Flush(); }
+
+  void Write(std::string_view text) {
+    if (buffer_.size() - size_ < text.size()) {
+      Flush();
+      if (buffer_.size() < text.size()) {
+        out_.write(text.data(), text.size());
+        return;
+      }
+    }
+    std::memcpy(buffer_.data() + size_, text.data(), text.size());
+    size_ += text.size();
+  }
+  void Write(char symbol) { Write(std::string_view(&symbol, 1)); }
+  template <typename T>
+  void WriteNumber(T value) {
+    Reserve(maxNumberLength);
+    auto result =
+        std::to_chars(buffer_.data() + size_, buffer_.data() + buffer_.size(),
+                      value);
+    size_ = result.ptr - buffer_.data();
+  }
+  template <typename T>
+  void WriteRaw(T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    Reserve(sizeof(T));
+    std::memcpy(buffer_.data() + size_, &value, sizeof(T));
+    size_ += sizeof(T);
+  }
+  void Flush() {
+    out_.write(buffer_.data(), size_);
+    size_ = 0;
+  }
+
+ private:
+  static constexpr std::size_t maxNumberLength = 32;
+
+  void Reserve(std::size_t amount) {
+    if (buffer_.size() - size_ < amount) {
+      Flush();
+    }
+  }
+
+  std::ostream& out_;
+  std::array<char, 1 << 16> buffer_;
+  std::size_t size_ = 0;
+};
+}  // namespace
+
+static double RejectionProbability(std::size_t rejected,
+                                   std::size_t recieved) {
+  return static_cast<double>(rejected) / recieved;
+}
+static double UsageCoefficient(const smo::DeviceStatistics& device,
+                               const smo::SimulationResults& results) {
+  return static_cast<double>(device.time_in_usage) /
+         results.simulation_time;
+}
+
+void smo::WriteCsvReport(std::ostream& out,
+                         const smo::SimulationResults& results) {
+  StreamWriter writer(out);
+  std::size_t recieved = results.recieved;
+  std::size_t rejected = results.rejected;
+  writer.Write(
+      "total_simulation_time,requests_recieved,requests_processed,"
+      "requests_rejected,rejection_probability\n");
+  writer.WriteNumber(results.simulation_time);
+  writer.Write(',');
+  writer.WriteNumber(recieved);
+  writer.Write(',');
+  writer.WriteNumber(recieved - rejected);
+  writer.Write(',');
+  writer.WriteNumber(rejected);
+  writer.Write(',');
+  writer.WriteNumber(RejectionProbability(rejected, recieved));
+  writer.Write("\n\n");
+
+  writer.Write(
+      "i,request_amount,rejection_probability,time_full,time_buffer,"
+      "time_processing,variance_buffer,variance_processing\n");
+  const auto& sources = results.sources;
+  for (std::size_t i = 0; i < sources.size(); ++i) {
+    const auto& source = sources[i];
+    auto buffer_time = source.AverageBufferTime();
+    auto device_time = source.AverageDeviceTime();
+    writer.WriteNumber(i);
+    writer.Write(',');
+    writer.WriteNumber(source.generated);
+    writer.Write(',');
+    writer.WriteNumber(RejectionProbability(source.rejected, source.generated));
+    writer.Write(',');
+    writer.WriteNumber(buffer_time + device_time);
+    writer.Write(',');
+    writer.WriteNumber(buffer_time);
+    writer.Write(',');
+    writer.WriteNumber(device_time);
+    writer.Write(',');
+    writer.WriteNumber(source.BufferTimeVariance());
+    writer.Write(',');
+    writer.WriteNumber(source.DeviceTimeVariance());
+    writer.Write('\n');
+  }
+  writer.Write('\n');
+
+  writer.Write("i,usage_coefficient\n");
+  const auto& devices = results.devices;
+  for (std::size_t i = 0; i < devices.size(); ++i) {
+    writer.WriteNumber(i);
+    writer.Write(',');
+    writer.WriteNumber(UsageCoefficient(devices[i], results));
+    writer.Write('\n');
+  }
+
+  const auto& classes = results.device_classes;
+  if (!classes.empty()) {
+    writer.Write("\nclass,devices,usage_coefficient\n");
+  }
+  for (std::size_t i = 0; i < classes.size(); ++i) {
+    writer.WriteNumber(i);
+    writer.Write(',');
+    writer.WriteNumber(classes[i].size);
+    writer.Write(',');
+    writer.WriteNumber(
+        classes[i].UsageCoefficient(results.simulation_time));
+    writer.Write('\n');
+  }
+  const auto& gradients = results.gradients;
+  if (!gradients.rejection_by_source_period.empty()) {
+    writer.Write("\nsource,rejection_by_period\n");
+  }
+  for (std::size_t i = 0; i < gradients.rejection_by_source_period.size();
+       ++i) {
+    writer.WriteNumber(i);
+    writer.Write(',');
+    writer.WriteNumber(gradients.rejection_by_source_period[i]);
+    writer.Write('\n');
+  }
+  if (!gradients.sojourn_by_device_coefficient.empty()) {
+    writer.Write("\ndevice,time_full_by_coefficient\n");
+  }
+  for (std::size_t i = 0; i < gradients.sojourn_by_device_coefficient.size();
+       ++i) {
+    writer.WriteNumber(i);
+    writer.Write(',');
+    writer.WriteNumber(gradients.sojourn_by_device_coefficient[i]);
+    writer.Write('\n');
+  }
+}
+
+// JSON has no representation for NaN and infinities.
+static void WriteJsonNumber(StreamWriter& writer, double value) {
+  if (std::isfinite(value)) {
+    writer.WriteNumber(value);
+  } else {
+    writer.Write("null");
+  }
+}
+
+void smo::WriteJsonLinesReport(std::ostream& out,
+                               const smo::SimulationResults& results) {
+  StreamWriter writer(out);
+  std::size_t recieved = results.recieved;
+  std::size_t rejected = results.rejected;
+  writer.Write("{\"type\":\"general\",\"total_simulation_time\":");
+  writer.WriteNumber(results.simulation_time);
+  writer.Write(",\"requests_recieved\":");
+  writer.WriteNumber(recieved);
+  writer.Write(",\"requests_processed\":");
+  writer.WriteNumber(recieved - rejected);
+  writer.Write(",\"requests_rejected\":");
+  writer.WriteNumber(rejected);
+  writer.Write(",\"rejection_probability\":");
+  WriteJsonNumber(writer, RejectionProbability(rejected, recieved));
+  writer.Write("}\n");
+
+  const auto& sources = results.sources;
+  for (std::size_t i = 0; i < sources.size(); ++i) {
+    const auto& source = sources[i];
+    auto buffer_time = source.AverageBufferTime();
+    auto device_time = source.AverageDeviceTime();
+    writer.Write("{\"type\":\"source\",\"i\":");
+    writer.WriteNumber(i);
+    writer.Write(",\"request_amount\":");
+    writer.WriteNumber(source.generated);
+    writer.Write(",\"rejection_probability\":");
+    WriteJsonNumber(writer,
+                    RejectionProbability(source.rejected, source.generated));
+    writer.Write(",\"time_full\":");
+    WriteJsonNumber(writer, buffer_time + device_time);
+    writer.Write(",\"time_buffer\":");
+    WriteJsonNumber(writer, buffer_time);
+    writer.Write(",\"time_processing\":");
+    WriteJsonNumber(writer, device_time);
+    writer.Write(",\"variance_buffer\":");
+    WriteJsonNumber(writer, source.BufferTimeVariance());
+    writer.Write(",\"variance_processing\":");
+    WriteJsonNumber(writer, source.DeviceTimeVariance());
+    writer.Write("}\n");
+  }
+
+  const auto& devices = results.devices;
+  for (std::size_t i = 0; i < devices.size(); ++i) {
+    writer.Write("{\"type\":\"device\",\"i\":");
+    writer.WriteNumber(i);
+    writer.Write(",\"usage_coefficient\":");
+    WriteJsonNumber(writer, UsageCoefficient(devices[i], results));
+    writer.Write("}\n");
+  }
+
+  const auto& classes = results.device_classes;
+  for (std::size_t i = 0; i < classes.size(); ++i) {
+    writer.Write("{\"type\":\"device_class\",\"i\":");
+    writer.WriteNumber(i);
+    writer.Write(",\"devices\":");
+    writer.WriteNumber(classes[i].size);
+    writer.Write(",\"usage_coefficient\":");
+    WriteJsonNumber(writer, classes[i].UsageCoefficient(
+                                results.simulation_time));
+    writer.Write("}\n");
+  }
+  const auto& gradients = results.gradients;
+  for (std::size_t i = 0; i < gradients.rejection_by_source_period.size();
+       ++i) {
+    writer.Write("{\"type\":\"source_gradient\",\"i\":");
+    writer.WriteNumber(i);
+    writer.Write(",\"rejection_by_period\":");
+    WriteJsonNumber(writer, gradients.rejection_by_source_period[i]);
+    writer.Write("}\n");
+  }
+  for (std::size_t i = 0; i < gradients.sojourn_by_device_coefficient.size();
+       ++i) {
+    writer.Write("{\"type\":\"device_gradient\",\"i\":");
+    writer.WriteNumber(i);
+    writer.Write(",\"time_full_by_coefficient\":");
+    WriteJsonNumber(writer, gradients.sojourn_by_device_coefficient[i]);
+    writer.Write("}\n");
+  }
+}
+
+template <typename T, typename F>
+static void WriteColumn(StreamWriter& writer,
+                        const std::vector<T>& statistics, F field) {
+  for (const auto& entity : statistics) {
+    writer.WriteRaw(field(entity));
+  }
+}
+
+void smo::WriteBinaryReport(std::ostream& out,
+                            const smo::SimulationResults& results) {
+  constexpr std::uint32_t version = 2;
+  StreamWriter writer(out);
+  const auto& sources = results.sources;
+  const auto& devices = results.devices;
+  writer.Write("SMOR");
+  writer.WriteRaw(version);
+  writer.WriteRaw(std::uint64_t{sources.size()});
+  writer.WriteRaw(std::uint64_t{devices.size()});
+  writer.WriteRaw(std::uint64_t{results.simulation_time});
+  writer.WriteRaw(std::uint64_t{results.recieved});
+  writer.WriteRaw(std::uint64_t{results.rejected});
+
+  WriteColumn(writer, sources, [](const SourceStatistics& s) {
+    return std::uint64_t{s.generated};
+  });
+  WriteColumn(writer, sources, [](const SourceStatistics& s) {
+    return std::uint64_t{s.rejected};
+  });
+  WriteColumn(writer, sources, [](const SourceStatistics& s) {
+    return std::uint64_t{s.time_in_buffer};
+  });
+  WriteColumn(writer, sources, [](const SourceStatistics& s) {
+    return std::uint64_t{s.time_in_device};
+  });
+  WriteColumn(writer, sources, [](const SourceStatistics& s) {
+    return s.time_squared_in_buffer;
+  });
+  WriteColumn(writer, sources, [](const SourceStatistics& s) {
+    return s.time_squared_in_device;
+  });
+  WriteColumn(writer, devices, [](const DeviceStatistics& d) {
+    return std::uint64_t{d.time_in_usage};
+  });
+  const auto& classes = results.device_classes;
+  writer.WriteRaw(std::uint64_t{classes.size()});
+  WriteColumn(writer, classes, [](const DeviceClassStatistics& c) {
+    return std::uint64_t{c.size};
+  });
+  WriteColumn(writer, classes, [](const DeviceClassStatistics& c) {
+    return std::uint64_t{c.time_in_usage};
+  });
+}
@@ -0,0 +1,31 @@
+#ifndef REPORT_WRITERS_H_
+#define REPORT_WRITERS_H_
+
+#include <iosfwd>
+
+#include "simulation_results.h"
+
+namespace smo {
+// Machine-readable reports. Unlike `PrintReport`, these stream statistics
+// straight to `out` without building intermediate tables.
+
+// Three blocks (general, sources, devices), each with its own header row,
+// separated by an empty line. Aggregated devices add a block of classes,
+// and gradient estimation adds blocks of source and device gradients.
+void WriteCsvReport(std::ostream& out,
+                    const smo::SimulationResults& results);
+// One JSON object per line, distinguished by the "type" field.
+void WriteJsonLinesReport(std::ostream& out,
+                          const smo::SimulationResults& results);
+// Columnar report in native byte order:
+//   char[4] "SMOR", u32 version, u64 sources, u64 devices,
+//   u64 simulation time, u64 requests recieved, u64 requests rejected,
+//   per source columns: u64 generated, u64 rejected, u64 time in buffer,
+//   u64 time in device, f64 squared time in buffer, f64 squared time in device,
+//   per device column: u64 time in usage,
+//   u64 device classes, per class columns: u64 devices, u64 time in usage.
+void WriteBinaryReport(std::ostream& out,
+                       const smo::SimulationResults& results);
+}  // namespace smo
+
+#endif
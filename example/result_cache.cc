@@ -0,0 +1,460 @@
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "result_cache.h"
+
+namespace {
+struct IndexHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t capacity;
+  std::uint64_t size;
+};
+// Records start after the data header, so zero offset marks empty slots.
+struct IndexSlot {
+  std::uint64_t hash;
+  std::uint64_t offset;
+};
+struct DataHeader {
+  char magic[4];
+  std::uint32_t version;
+};
+// Followed by the key and the payload.
+struct RecordHeader {
+  std::uint64_t key_size;
+  std::uint64_t payload_size;
+};
+
+// Holds the lock of a file descriptor while alive.
+class FileLock {
+ public:
+  FileLock(int descriptor, int operation) : descriptor_(descriptor) {
+    while (::flock(descriptor_, operation) == -1 && errno == EINTR) {
+    }
+  }
+  FileLock(const FileLock&) = delete;
+  FileLock& operator=(const FileLock&) = delete;
+  ~FileLock() { ::flock(descriptor_, LOCK_UN); }
+
+ private:
+  int descriptor_;
+};
+}  // namespace
+
+static constexpr char indexMagic[4] = {'S', 'M', 'O', 'I'};
+static constexpr char dataMagic[4] = {'S', 'M', 'O', 'D'};
+static constexpr std::uint32_t cacheVersion = 1;
+static constexpr std::uint64_t initialIndexCapacity = 1 << 10;
+
+// Statistics are stored as raw bytes.
+static_assert(std::is_trivially_copyable_v<smo::SourceStatistics>);
+
+// FNV-1a, which doesn't depend on the standard library implementation.
+static std::uint64_t StableHash(std::string_view bytes) {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (unsigned char byte : bytes) {
+    hash = (hash ^ byte) * 1099511628211ull;
+  }
+  return hash;
+}
+
+template <typename T>
+static void AppendRaw(std::string& bytes, const T& value) {
+  bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+template <typename T>
+static void AppendArray(std::string& bytes, std::span<const T> values) {
+  AppendRaw(bytes, std::uint64_t{values.size()});
+  bytes.append(reinterpret_cast<const char*>(values.data()),
+               values.size_bytes());
+}
+
+std::string smo::ModelKey(const SimulatorConfig& config, SimulatorLaw law,
+                          DeviceGrouping grouping, SourceArrivals arrivals) {
+  std::string key;
+  AppendRaw(key, libraryVersion);
+  AppendRaw(key, static_cast<std::uint32_t>(law));
+  AppendRaw(key, static_cast<std::uint32_t>(grouping));
+  AppendRaw(key, static_cast<std::uint32_t>(arrivals));
+  AppendRaw(key, std::uint64_t{config.buffer_capacity});
+  AppendRaw(key, std::uint64_t{config.target_amount_of_requests});
+  AppendRaw(key, static_cast<std::uint32_t>(config.buffer_discipline));
+  AppendRaw(key, static_cast<std::uint32_t>(config.device_selection));
+  AppendArray(key, config.source_periods);
+  AppendArray(key, config.device_coefficients);
+  AppendArray(key, config.source_weights);
+  AppendArray(key, config.source_job_sizes);
+  AppendArray(key, config.source_batch_sizes);
+  return key;
+}
+
+static std::string ReplicationKey(std::string_view model_key,
+                                  std::uint64_t seed) {
+  std::string key(model_key);
+  AppendRaw(key, seed);
+  return key;
+}
+
+static std::string SerializeResults(const smo::SimulationResults& results) {
+  std::string payload;
+  AppendRaw(payload, std::uint64_t{results.simulation_time});
+  AppendRaw(payload, std::uint64_t{results.recieved});
+  AppendRaw(payload, std::uint64_t{results.rejected});
+  AppendArray(payload, std::span<const smo::SourceStatistics>(results.sources));
+  AppendRaw(payload, std::uint64_t{results.devices.size()});
+  for (const auto& device : results.devices) {
+    AppendRaw(payload, std::uint64_t{device.time_in_usage});
+  }
+  AppendRaw(payload, std::uint64_t{results.device_classes.size()});
+  for (const auto& device_class : results.device_classes) {
+    AppendRaw(payload, std::uint64_t{device_class.size});
+    AppendRaw(payload, std::uint64_t{device_class.time_in_usage});
+  }
+  return payload;
+}
+
+namespace {
+// Reads values from the payload, until it runs out.
+class PayloadReader {
+ public:
+  explicit PayloadReader(std::string_view payload) : payload_(payload) {}
+
+  template <typename T>
+  bool Read(T& value) {
+    if (payload_.size() < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&value, payload_.data(), sizeof(T));
+    payload_.remove_prefix(sizeof(T));
+    return true;
+  }
+  template <typename T>
+  bool ReadArray(std::vector<T>& values, std::uint64_t amount) {
+    if (payload_.size() / sizeof(T) < amount) {
+      return false;
+    }
+    values.resize(amount);
+    std::memcpy(values.data(), payload_.data(), amount * sizeof(T));
+    payload_.remove_prefix(amount * sizeof(T));
+    return true;
+  }
+  bool at_end() const { return payload_.empty(); }
+
+ private:
+  std::string_view payload_;
+};
+}  // namespace
+
+static std::optional<smo::SimulationResults> DeserializeResults(
+    std::string_view payload) {
+  PayloadReader reader(payload);
+  smo::SimulationResults results;
+  results.replications = 1;
+  std::uint64_t simulation_time = 0;
+  std::uint64_t recieved = 0;
+  std::uint64_t rejected = 0;
+  std::uint64_t amount = 0;
+  if (!reader.Read(simulation_time) || !reader.Read(recieved) ||
+      !reader.Read(rejected) || !reader.Read(amount) ||
+      !reader.ReadArray(results.sources, amount) || !reader.Read(amount) ||
+      payload.size() / 8 < amount) {
+    return std::nullopt;
+  }
+  results.simulation_time = simulation_time;
+  results.recieved = recieved;
+  results.rejected = rejected;
+  results.devices.resize(amount);
+  for (auto& device : results.devices) {
+    std::uint64_t time_in_usage = 0;
+    if (!reader.Read(time_in_usage)) {
+      return std::nullopt;
+    }
+    device.time_in_usage = time_in_usage;
+  }
+  if (!reader.Read(amount) || payload.size() / 16 < amount) {
+    return std::nullopt;
+  }
+  results.device_classes.resize(amount);
+  for (auto& device_class : results.device_classes) {
+    std::uint64_t size = 0;
+    std::uint64_t time_in_usage = 0;
+    if (!reader.Read(size) || !reader.Read(time_in_usage)) {
+      return std::nullopt;
+    }
+    device_class.size = size;
+    device_class.time_in_usage = time_in_usage;
+  }
+  if (!reader.at_end()) {
+    return std::nullopt;
+  }
+  return results;
+}
+
+// Open addressing hash table in a shared mapping of the index file. Only
+// used under the lock.
+class smo::ResultCache::Index {
+ public:
+  // Creates the file, if it doesn't exist and `capacity` isn't zero.
+  // Returns nullptr on error.
+  static std::unique_ptr<Index> Open(const std::string& path,
+                                     std::uint64_t capacity) {
+    int descriptor =
+        ::open(path.c_str(), capacity == 0 ? O_RDWR : O_RDWR | O_CREAT, 0666);
+    if (descriptor == -1) {
+      return nullptr;
+    }
+    struct stat status;
+    if (::fstat(descriptor, &status) == -1) {
+      ::close(descriptor);
+      return nullptr;
+    }
+    std::size_t size = status.st_size;
+    bool is_new = size == 0;
+    if (is_new) {
+      size = sizeof(IndexHeader) + capacity * sizeof(IndexSlot);
+      if (capacity == 0 || ::ftruncate(descriptor, size) == -1) {
+        ::close(descriptor);
+        return nullptr;
+      }
+    }
+    void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                           descriptor, 0);
+    ::close(descriptor);
+    if (mapping == MAP_FAILED) {
+      return nullptr;
+    }
+    std::unique_ptr<Index> index(new Index(static_cast<char*>(mapping), size));
+    if (is_new) {
+      IndexHeader header{{}, cacheVersion, capacity, 0};
+      std::memcpy(header.magic, indexMagic, sizeof(header.magic));
+      std::memcpy(index->data_, &header, sizeof(header));
+    }
+    if (!index->IsValid()) {
+      return nullptr;
+    }
+    return index;
+  }
+  Index(const Index&) = delete;
+  Index& operator=(const Index&) = delete;
+  ~Index() { ::munmap(data_, size_); }
+
+  // Slot with the hash, or the empty one, where probing for it stops.
+  // Probing starts at `hash`, and gives up with nullptr after visiting every
+  // slot, which only happens to a corrupted index without empty slots.
+  IndexSlot* Probe(std::uint64_t hash, std::uint64_t& position) {
+    auto capacity = header().capacity;
+    for (; position - hash < capacity; ++position) {
+      auto& slot = slots()[position & (capacity - 1)];
+      if (slot.offset == 0 || slot.hash == hash) {
+        return &slot;
+      }
+    }
+    return nullptr;
+  }
+  IndexHeader& header() { return *reinterpret_cast<IndexHeader*>(data_); }
+  IndexSlot* slots() {
+    return reinterpret_cast<IndexSlot*>(data_ + sizeof(IndexHeader));
+  }
+
+ private:
+  Index(char* data, std::size_t size) : data_(data), size_(size) {}
+  bool IsValid() {
+    if (size_ < sizeof(IndexHeader) ||
+        std::memcmp(header().magic, indexMagic, sizeof(indexMagic)) != 0 ||
+        header().version != cacheVersion) {
+      return false;
+    }
+    auto capacity = header().capacity;
+    return capacity != 0 && (capacity & (capacity - 1)) == 0 &&
+           capacity <= (size_ - sizeof(IndexHeader)) / sizeof(IndexSlot);
+  }
+
+  char* data_;
+  std::size_t size_;
+};
+
+std::unique_ptr<smo::ResultCache> smo::ResultCache::Open(
+    const std::string& directory) {
+  if (::mkdir(directory.c_str(), 0777) == -1 && errno != EEXIST) {
+    return nullptr;
+  }
+  int lock_descriptor =
+      ::open((directory + "/lock").c_str(), O_RDWR | O_CREAT, 0666);
+  if (lock_descriptor == -1) {
+    return nullptr;
+  }
+  int data_descriptor =
+      ::open((directory + "/data").c_str(), O_RDWR | O_CREAT, 0666);
+  if (data_descriptor == -1) {
+    ::close(lock_descriptor);
+    return nullptr;
+  }
+  std::unique_ptr<ResultCache> cache(
+      new ResultCache(directory, lock_descriptor, data_descriptor));
+  FileLock lock(lock_descriptor, LOCK_EX);
+  struct stat status;
+  if (::fstat(data_descriptor, &status) == -1) {
+    return nullptr;
+  }
+  DataHeader header{{}, cacheVersion};
+  std::memcpy(header.magic, dataMagic, sizeof(header.magic));
+  if (status.st_size == 0) {
+    if (::pwrite(data_descriptor, &header, sizeof(header), 0) !=
+        sizeof(header)) {
+      return nullptr;
+    }
+  } else {
+    DataHeader file_header{};
+    if (::pread(data_descriptor, &file_header, sizeof(file_header), 0) !=
+            sizeof(file_header) ||
+        std::memcmp(&file_header, &header, sizeof(header)) != 0) {
+      return nullptr;
+    }
+  }
+  return cache;
+}
+
+smo::ResultCache::ResultCache(std::string directory, int lock_descriptor,
+                              int data_descriptor)
+    : directory_(std::move(directory)),
+      lock_descriptor_(lock_descriptor),
+      data_descriptor_(data_descriptor) {}
+
+smo::ResultCache::~ResultCache() {
+  ::close(lock_descriptor_);
+  ::close(data_descriptor_);
+}
+
+std::optional<smo::SimulationResults> smo::ResultCache::Find(
+    std::string_view model_key, std::uint64_t seed) const {
+  auto key = ReplicationKey(model_key, seed);
+  auto hash = StableHash(key);
+  FileLock lock(lock_descriptor_, LOCK_SH);
+  auto index = Index::Open(directory_ + "/index", 0);
+  if (index == nullptr) {
+    return std::nullopt;
+  }
+  auto position = hash;
+  while (true) {
+    auto* slot = index->Probe(hash, position);
+    if (slot == nullptr || slot->offset == 0) {
+      return std::nullopt;
+    }
+    auto results = ReadRecord(slot->offset, key);
+    if (results.has_value()) {
+      return results;
+    }
+    position += 1;
+  }
+}
+
+// Nullopt, if the record has another key with the same hash.
+std::optional<smo::SimulationResults> smo::ResultCache::ReadRecord(
+    std::uint64_t offset, std::string_view key) const {
+  RecordHeader header{};
+  if (::pread(data_descriptor_, &header, sizeof(header), offset) !=
+          sizeof(header) ||
+      header.key_size != key.size()) {
+    return std::nullopt;
+  }
+  std::string record(header.key_size + header.payload_size, '\0');
+  if (::pread(data_descriptor_, record.data(), record.size(),
+              offset + sizeof(header)) !=
+          static_cast<ssize_t>(record.size()) ||
+      std::string_view(record).substr(0, key.size()) != key) {
+    return std::nullopt;
+  }
+  return DeserializeResults(std::string_view(record).substr(key.size()));
+}
+
+void smo::ResultCache::Store(std::string_view model_key, std::uint64_t seed,
+                             const SimulationResults& results) {
+  auto key = ReplicationKey(model_key, seed);
+  auto hash = StableHash(key);
+  auto payload = SerializeResults(results);
+  FileLock lock(lock_descriptor_, LOCK_EX);
+  auto index_path = directory_ + "/index";
+  auto index = Index::Open(index_path, initialIndexCapacity);
+  if (index == nullptr) {
+    return;
+  }
+  auto position = hash;
+  IndexSlot* slot = nullptr;
+  while (true) {
+    slot = index->Probe(hash, position);
+    if (slot == nullptr) {
+      return;
+    }
+    if (slot->offset == 0) {
+      break;
+    }
+    if (ReadRecord(slot->offset, key).has_value()) {
+      return;
+    }
+    position += 1;
+  }
+  struct stat status;
+  if (::fstat(data_descriptor_, &status) == -1) {
+    return;
+  }
+  std::uint64_t offset = status.st_size;
+  RecordHeader header{key.size(), payload.size()};
+  std::string record;
+  AppendRaw(record, header);
+  record += key;
+  record += payload;
+  if (::pwrite(data_descriptor_, record.data(), record.size(), offset) !=
+      static_cast<ssize_t>(record.size())) {
+    return;
+  }
+  *slot = IndexSlot{hash, offset};
+  auto& index_header = index->header();
+  index_header.size += 1;
+  if (2 * index_header.size <= index_header.capacity) {
+    return;
+  }
+  // Keeps the load factor below a half, by rehashing into a new file, which
+  // replaces the old one atomically.
+  auto grown_path = index_path + ".new";
+  ::unlink(grown_path.c_str());
+  auto grown = Index::Open(grown_path, 2 * index_header.capacity);
+  if (grown == nullptr) {
+    return;
+  }
+  for (std::uint64_t i = 0; i < index_header.capacity; ++i) {
+    const auto& old_slot = index->slots()[i];
+    if (old_slot.offset != 0) {
+      auto grown_position = old_slot.hash;
+      auto* grown_slot = grown->Probe(old_slot.hash, grown_position);
+      // Equal hashes of different keys are kept apart.
+      while (grown_slot != nullptr && grown_slot->offset != 0) {
+        grown_position += 1;
+        grown_slot = grown->Probe(old_slot.hash, grown_position);
+      }
+      if (grown_slot == nullptr) {
+        ::unlink(grown_path.c_str());
+        return;
+      }
+      *grown_slot = old_slot;
+    }
+  }
+  grown->header().size = index_header.size;
+  ::rename(grown_path.c_str(), index_path.c_str());
+}
@@ -0,0 +1,49 @@
+#ifndef RESULT_CACHE_H_
+#define RESULT_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "simulation_results.h"
+#include "simulator.h"
+#include "simulator_config.h"
+
+namespace smo {
+// Stable description of everything but the seed, which determines results
+// of a run, including the library version.
+std::string ModelKey(const SimulatorConfig& config, SimulatorLaw law,
+                     DeviceGrouping grouping, SourceArrivals arrivals);
+// Results of single replications, persisted in a directory, so that runs of
+// the same model with the same seed are read instead of simulated. The
+// directory holds an append-only data file and a memory-mapped hash index
+// of it. Every operation takes a file lock, so the cache can be shared by
+// processes. Gradients are not stored.
+class ResultCache {
+ public:
+  // Returns nullptr if the directory can't be created or opened.
+  static std::unique_ptr<ResultCache> Open(const std::string& directory);
+  ResultCache(const ResultCache&) = delete;
+  ResultCache& operator=(const ResultCache&) = delete;
+  ~ResultCache();
+
+  std::optional<SimulationResults> Find(std::string_view model_key,
+                                        std::uint64_t seed) const;
+  void Store(std::string_view model_key, std::uint64_t seed,
+             const SimulationResults& results);
+
+ private:
+  class Index;
+  ResultCache(std::string directory, int lock_descriptor,
+              int data_descriptor);
+  std::optional<SimulationResults> ReadRecord(std::uint64_t offset,
+                                              std::string_view key) const;
+
+  std::string directory_;
+  int lock_descriptor_;
+  int data_descriptor_;
+};
+}  // namespace smo
+#endif
@@ -8,6 +8,8 @@ enum Result {
   outputFileError = 2,
   configError = 3,
   incorrectGuess = 4,
+  cacheError = 5,
+  engineMismatch = 6,
 };
 }
 
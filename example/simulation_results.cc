@@ -0,0 +1,67 @@
+#include <cstddef>
+#include <vector>
+
+#include "simulation_results.h"
+
+smo::SimulationResults smo::CollectResults(const Simulator& simulator) {
+  return SimulationResults{
+      1,
+      simulator.current_simulation_time(),
+      simulator.current_amount_of_requests(),
+      simulator.rejected_amount(),
+      {simulator.source_statistics().begin(),
+       simulator.source_statistics().end()},
+      {simulator.device_statistics().begin(),
+       simulator.device_statistics().end()},
+      {simulator.device_class_statistics().begin(),
+       simulator.device_class_statistics().end()},
+      simulator.gradient_estimates(),
+  };
+}
+
+// Gradients are averages over requests, so they are pooled the same way.
+static void MergeGradients(std::vector<double>& gradients,
+                           std::size_t recieved,
+                           const std::vector<double>& other,
+                           std::size_t other_recieved) {
+  for (std::size_t i = 0; i < gradients.size() && i < other.size(); ++i) {
+    gradients[i] = (gradients[i] * recieved + other[i] * other_recieved) /
+                   (recieved + other_recieved);
+  }
+}
+
+void smo::MergeResults(SimulationResults& results,
+                       const SimulationResults& other) {
+  if (results.replications == 0) {
+    results = other;
+    return;
+  }
+  MergeGradients(results.gradients.sojourn_by_device_coefficient,
+                 results.recieved,
+                 other.gradients.sojourn_by_device_coefficient,
+                 other.recieved);
+  MergeGradients(results.gradients.rejection_by_source_period,
+                 results.recieved, other.gradients.rejection_by_source_period,
+                 other.recieved);
+  results.replications += other.replications;
+  results.simulation_time += other.simulation_time;
+  results.recieved += other.recieved;
+  results.rejected += other.rejected;
+  for (std::size_t i = 0; i < results.sources.size(); ++i) {
+    auto& source = results.sources[i];
+    const auto& other_source = other.sources[i];
+    source.generated += other_source.generated;
+    source.rejected += other_source.rejected;
+    source.time_in_buffer += other_source.time_in_buffer;
+    source.time_in_device += other_source.time_in_device;
+    source.time_squared_in_buffer += other_source.time_squared_in_buffer;
+    source.time_squared_in_device += other_source.time_squared_in_device;
+  }
+  for (std::size_t i = 0; i < results.devices.size(); ++i) {
+    results.devices[i].time_in_usage += other.devices[i].time_in_usage;
+  }
+  for (std::size_t i = 0; i < results.device_classes.size(); ++i) {
+    results.device_classes[i].time_in_usage +=
+        other.device_classes[i].time_in_usage;
+  }
+}
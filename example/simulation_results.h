@@ -0,0 +1,28 @@
+#ifndef SIMULATION_RESULTS_H_
+#define SIMULATION_RESULTS_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "../smo_components.h"
+#include "simulator.h"
+
+namespace smo {
+// Statistics of finished runs, detached from the simulator, so that they
+// can be cached and merged across replications.
+struct SimulationResults {
+  std::size_t replications = 0;
+  Time simulation_time = 0;
+  std::size_t recieved = 0;
+  std::size_t rejected = 0;
+  std::vector<SourceStatistics> sources;
+  std::vector<DeviceStatistics> devices;
+  std::vector<DeviceClassStatistics> device_classes;
+  GradientEstimates gradients;
+};
+SimulationResults CollectResults(const Simulator& simulator);
+// Pools statistics, as if replications were run one after another. Times
+// add up, so averages and usage coefficients are weighted by run lengths.
+void MergeResults(SimulationResults& results, const SimulationResults& other);
+}  // namespace smo
+#endif
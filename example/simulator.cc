@@ -1,8 +1,10 @@
 #include <algorithm>
+#include <bit>
+#include <cmath>
 #include <cstddef>
-#include <deque>
-#include <functional>
 #include <optional>
+#include <span>
+#include <unordered_map>
 #include <vector>
 
 #include "simulator.h"
@@ -12,131 +14,285 @@ smo::Simulator::Simulator(std::vector<smo::Time> source_periods,
                           std::size_t buffer_capacity,
                           std::size_t target_amount_of_requests,
                           SimulatorLaw law)
-    : smo::SimulatorBase{source_periods.size(), device_coefficients.size(),
-                         target_amount_of_requests},
+    : smo::Simulator{MakeSimulatorConfig(buffer_capacity,
+                                         target_amount_of_requests,
+                                         std::move(source_periods),
+                                         std::move(device_coefficients)),
+                     law} {}
+// Devices with equal coefficients form a class. Classes go in order of the
+// first appearance, or from the fastest one for `fastest` selection.
+static std::vector<std::size_t> GroupDevices(
+    std::span<const double> coefficients, smo::DeviceSelection selection,
+    std::vector<double>& class_coefficients) {
+  std::vector<std::size_t> class_sizes;
+  std::unordered_map<double, std::size_t> class_ids;
+  for (double coefficient : coefficients) {
+    auto [entry, is_new] =
+        class_ids.try_emplace(coefficient, class_coefficients.size());
+    if (is_new) {
+      class_coefficients.push_back(coefficient);
+      class_sizes.push_back(0);
+    }
+    class_sizes[entry->second] += 1;
+  }
+  if (selection == smo::DeviceSelection::fastest) {
+    std::vector<std::size_t> order(class_sizes.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t lhs, std::size_t rhs) {
+                       return class_coefficients[lhs] <
+                              class_coefficients[rhs];
+                     });
+    std::vector<double> sorted_coefficients;
+    std::vector<std::size_t> sorted_sizes;
+    for (auto i : order) {
+      sorted_coefficients.push_back(class_coefficients[i]);
+      sorted_sizes.push_back(class_sizes[i]);
+    }
+    class_coefficients = std::move(sorted_coefficients);
+    class_sizes = std::move(sorted_sizes);
+  }
+  return class_sizes;
+}
+
+smo::Simulator::Simulator(SimulatorConfig config, SimulatorLaw law,
+                          DeviceGrouping grouping, SourceArrivals arrivals,
+                          std::pmr::memory_resource* resource)
+    : smo::SimulatorBase{config.source_periods.size(),
+                         config.device_coefficients.size(),
+                         config.target_amount_of_requests, resource},
       law_(law),
+      arrivals_(arrivals),
       random_gen_(std::mt19937(std::random_device{}())),
-      source_periods_(std::move(source_periods)),
-      device_coefficients_(std::move(device_coefficients)),
-      storage_(std::vector<std::deque<smo::Request>>(source_periods_.size())),
-      buffer_capacity_(buffer_capacity) {
-  next_device_pointer_ = device_statistics().begin();
+      source_periods_(config.source_periods),
+      device_coefficients_(config.device_coefficients),
+      source_job_sizes_(config.source_job_sizes),
+      source_batch_sizes_(config.source_batch_sizes),
+      config_storage_(std::move(config.storage)),
+      initial_events_(resource),
+      storage_(BufferStorage(config.buffer_capacity, source_periods_.size(),
+                             resource)),
+      buffer_policy_(MakeBufferPolicy(config, resource)),
+      device_policy_(grouping == DeviceGrouping::individual
+                         ? MakeDevicePolicy(config, device_statistics(),
+                                            random_gen_, resource)
+                         : nullptr),
+      arrival_positions_(resource) {
+  if (grouping == DeviceGrouping::aggregated) {
+    AggregateDevices(GroupDevices(device_coefficients_,
+                                  config.device_selection,
+                                  class_coefficients_));
+  }
+  if (arrivals_ == SourceArrivals::mergedPoisson) {
+    GroupSourcesByPeriod();
+  }
   Init();
 }
-smo::Simulator::Simulator(SimulatorConfig config, SimulatorLaw law)
-    : smo::Simulator{std::move(config.source_periods),
-                     std::move(config.device_coefficients),
-                     config.buffer_capacity, config.target_amount_of_requests,
-                     law} {}
+void smo::Simulator::UseTraces(std::shared_ptr<const Trace> arrival_trace,
+                               std::shared_ptr<const Trace> service_trace) {
+  arrival_trace_ = std::move(arrival_trace);
+  service_trace_ = std::move(service_trace);
+  arrival_positions_.assign(
+      arrival_trace_ == nullptr ? 0 : source_periods_.size(), 0);
+  Reset();
+}
+void smo::Simulator::Seed(std::uint64_t seed) {
+  std::seed_seq sequence{static_cast<std::uint32_t>(seed),
+                         static_cast<std::uint32_t>(seed >> 32)};
+  random_gen_.seed(sequence);
+  distribution_.reset();
+  fraction_distribution_.reset();
+  Reset();
+}
 void smo::Simulator::Reset() {
   smo::SimulatorBase::Reset();
-  for (auto& subbuffer : storage_) {
-    subbuffer.clear();
+  std::fill(arrival_positions_.begin(), arrival_positions_.end(), 0);
+  storage_.Clear();
+  buffer_policy_->Clear();
+  if (device_policy_ != nullptr) {
+    device_policy_->Clear();
   }
   Init();
 }
 
 void smo::Simulator::Init() {
+  switch (arrivals_) {
+    case SourceArrivals::periodic:
+    case SourceArrivals::poisson:
+      // Only periodic first arrivals are the same after every reset.
+      if (arrivals_ == SourceArrivals::poisson || arrival_trace_ != nullptr) {
+        initial_events_.clear();
+      }
+      if (initial_events_.empty()) {
+        initial_events_.reserve(source_periods_.size());
+        for (std::size_t i = 0; i < source_periods_.size(); ++i) {
+          initial_events_.push_back(SpecialEvent{
+              SpecialEventKind::generateNewRequest,
+              SourcePeriod(i),
+              i,
+          });
+        }
+      }
+      break;
+    case SourceArrivals::mergedPoisson:
+      initial_events_.clear();
+      for (std::size_t i = 0; i < group_sources_.size(); ++i) {
+        auto arrival = NextGroupArrival(i);
+        initial_events_.push_back(SpecialEvent{
+            SpecialEventKind::generateNewRequest,
+            arrival.period,
+            arrival.source_id,
+        });
+      }
+      break;
+  }
+  AddSpecialEvents(initial_events_);
+}
+
+void smo::Simulator::GroupSourcesByPeriod() {
+  std::vector<std::size_t> source_groups(source_periods_.size());
+  std::unordered_map<int, std::size_t> group_ids;
   for (std::size_t i = 0; i < source_periods_.size(); ++i) {
-    AddSpecialEvent(SpecialEvent{
-        SpecialEventKind::generateNewRequest,
-        source_periods_[i],
-        i,
-    });
-  }
-}
-std::vector<smo::Request> smo::Simulator::FakeBuffer() const {
-  std::vector<Request> result;
-  result.reserve(buffer_capacity_);
-  for (const auto& subbuffer : storage_) {
-    result.insert(result.end(), subbuffer.begin(), subbuffer.end());
-  }
-  std::sort(result.begin(), result.end(),
-            [](const Request& lhs, const Request& rhs) {
-              if (lhs.generation_time == rhs.generation_time) {
-                return lhs.source_id < rhs.source_id;
-              } else {
-                return lhs.generation_time < rhs.generation_time;
-              }
-            });
-  return result;
+    auto period = source_periods_[i];
+    auto [entry, is_new] =
+        group_ids.try_emplace(std::bit_width(period), group_sources_.size());
+    if (is_new) {
+      group_sources_.emplace_back();
+      group_min_periods_.push_back(period);
+    }
+    auto group_id = entry->second;
+    group_sources_[group_id].push_back(i);
+    group_min_periods_[group_id] =
+        std::min(group_min_periods_[group_id], period);
+    source_groups[i] = group_id;
+  }
+  GroupSources(source_groups);
 }
 
-std::size_t smo::Simulator::current_packet() const { return current_packet_; }
+smo::BufferStorage::Range smo::Simulator::FakeBuffer() const {
+  return storage_.ArrivalOrder();
+}
 
-const std::vector<std::deque<smo::Request>>& smo::Simulator::RealBuffer()
-    const {
+std::optional<std::size_t> smo::Simulator::current_packet() const {
+  return buffer_policy_->current_packet();
+}
+
+const smo::BufferStorage& smo::Simulator::RealBuffer() const {
   return storage_;
 }
 
 std::optional<smo::Request> smo::Simulator::PutInBuffer(Request request) {
-  std::optional<Request> rejected;
-  if (buffer_size_ == buffer_capacity_) {
-    auto not_empty_subbuffer =
-        std::find_if_not(storage_.rbegin(), storage_.rend(),
-                         std::mem_fn(&std::deque<Request>::empty));
-    rejected = not_empty_subbuffer->front();
-    not_empty_subbuffer->pop_front();
-    buffer_size_ -= 1;
-  }
-  storage_[request.source_id].push_back(request);
-  buffer_size_ += 1;
-  return rejected;
+  return buffer_policy_->Put(storage_, request);
 }
 std::optional<smo::Request> smo::Simulator::TakeOutOfBuffer() {
-  if (buffer_size_ == 0) {
+  if (storage_.empty()) {
     return std::nullopt;
   } else {
-    std::deque<Request>* subbuffer = &storage_[current_packet_];
-    if (subbuffer->empty()) {
-      auto not_empty_subbuffer =
-          std::find_if_not(storage_.begin(), storage_.end(),
-                           std::mem_fn(&std::deque<Request>::empty));
-      current_packet_ = not_empty_subbuffer - storage_.begin();
-      subbuffer = &*not_empty_subbuffer;
-    }
-    auto result = subbuffer->front();
-    subbuffer->pop_front();
-    buffer_size_ -= 1;
-    return result;
+    return buffer_policy_->Take(storage_);
   }
 }
 std::optional<std::size_t> smo::Simulator::PickDevice() {
-  std::optional<std::size_t> result;
-  auto DeviceIsOccupied = [](const DeviceStatistics& device) {
-    return device.current_request.has_value();
-  };
-  const auto& devices = device_statistics();
-  auto candidate =
-      std::find_if_not(next_device_pointer_, devices.end(), DeviceIsOccupied);
-  if (candidate != devices.end()) {
-    result = candidate - devices.begin();
-  }
-  if (!result.has_value()) {
-    candidate = std::find_if_not(devices.begin(), next_device_pointer_,
-                                 DeviceIsOccupied);
-  }
-  if (candidate != next_device_pointer_) {
-    result = candidate - devices.begin();
-  }
-  if (result.has_value()) {
-    if (++candidate == devices.end()) {
-      next_device_pointer_ = devices.begin();
-    } else {
-      next_device_pointer_ = candidate;
+  if (device_policy_ != nullptr) {
+    return device_policy_->Pick();
+  }
+  const auto& classes = device_class_statistics();
+  for (std::size_t i = 0; i < classes.size(); ++i) {
+    if (classes[i].busy < classes[i].size) {
+      return i;
     }
   }
-  return result;
+  return std::nullopt;
+}
+void smo::Simulator::OnDeviceRelease(std::size_t device_id) {
+  device_policy_->Release(device_id);
 }
 smo::Time smo::Simulator::DeviceProcessingTime(std::size_t device_id,
                                                const Request& request) {
+  double mean = device_coefficients_[device_id];
+  if (service_trace_ != nullptr) {
+    auto demand = service_trace_->At(request.source_id, request.number);
+    if (demand.has_value()) {
+      return smo::Time(std::round(mean * *demand));
+    }
+  }
+  if (!source_job_sizes_.empty()) {
+    mean *= source_job_sizes_[request.source_id];
+  }
   if (law_ == SimulatorLaw::deterministic) {
-    return smo::Time(device_coefficients_[device_id]);
+    return smo::Time(mean);
   } else {
-    return smo::Time(device_coefficients_[device_id] *
-                     distribution_(random_gen_));
+    return smo::Time(mean * distribution_(random_gen_));
   }
 }
 smo::Time smo::Simulator::SourcePeriod(std::size_t source_id) {
-  return source_periods_[source_id];
+  if (arrival_trace_ != nullptr) {
+    auto interval =
+        arrival_trace_->At(source_id, arrival_positions_[source_id]);
+    if (interval.has_value()) {
+      arrival_positions_[source_id] += 1;
+      return smo::Time(std::round(*interval));
+    }
+  }
+  if (arrivals_ == SourceArrivals::periodic) {
+    return source_periods_[source_id];
+  }
+  return RoundTime(source_periods_[source_id] * distribution_(random_gen_));
+}
+// Processing times scale with device coefficients.
+double smo::Simulator::ProcessingTimeDerivative(std::size_t device_id,
+                                                Time processing_time) {
+  return processing_time / device_coefficients_[device_id];
+}
+// Only Poisson sources have random periods. Recorded ones are left out.
+double smo::Simulator::SourcePeriodScore(std::size_t source_id, Time period) {
+  if (arrivals_ != SourceArrivals::poisson || arrival_trace_ != nullptr) {
+    return 0.0;
+  }
+  double mean = source_periods_[source_id];
+  return (static_cast<double>(period) - mean) / (mean * mean);
+}
+// Geometric with the given mean, so that batches are as memoryless as
+// exponential intervals between them.
+std::size_t smo::Simulator::BatchSize(std::size_t source_id) {
+  if (source_batch_sizes_.empty()) {
+    return 1;
+  }
+  double mean = source_batch_sizes_[source_id];
+  if (law_ == SimulatorLaw::deterministic) {
+    return std::size_t(std::round(mean));
+  }
+  return 1 + std::geometric_distribution<std::size_t>{1.0 / mean}(random_gen_);
+}
+// Candidates arrive as if every source of the group had the shortest period,
+// and each one is kept with probability of the actual rate relative to it.
+smo::GroupArrival smo::Simulator::NextGroupArrival(std::size_t group_id) {
+  const auto& sources = group_sources_[group_id];
+  double min_period = group_min_periods_[group_id];
+  double candidate_period = min_period / sources.size();
+  double period = 0.0;
+  while (true) {
+    period += candidate_period * distribution_(random_gen_);
+    auto source_id = sources[std::uniform_int_distribution<std::size_t>{
+        0, sources.size() - 1}(random_gen_)];
+    if (source_periods_[source_id] == min_period ||
+        fraction_distribution_(random_gen_) * source_periods_[source_id] <
+            min_period) {
+      return GroupArrival{RoundTime(period), source_id};
+    }
+  }
+}
+smo::Time smo::Simulator::RoundTime(double time) {
+  return smo::Time(time + fraction_distribution_(random_gen_));
+}
+smo::Time smo::Simulator::DeviceClassPeriod(std::size_t class_id,
+                                            std::size_t busy) {
+  return RoundTime(class_coefficients_[class_id] / busy *
+                   distribution_(random_gen_));
+}
+std::size_t smo::Simulator::PickServedRequest(std::size_t class_id,
+                                              std::size_t amount) {
+  return std::uniform_int_distribution<std::size_t>{0, amount - 1}(
+      random_gen_);
 }
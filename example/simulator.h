@@ -1,28 +1,59 @@
 #ifndef SIMULATOR_H_
 #define SIMULATOR_H_
 #include <cstddef>
-#include <deque>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <random>
+#include <span>
 #include <vector>
 
 #include "../simulator_base.h"
 #include "../smo_components.h"
+#include "buffer_policy.h"
+#include "buffer_storage.h"
+#include "device_policy.h"
 #include "simulator_config.h"
+#include "trace.h"
 
 namespace smo {
 enum class SimulatorLaw { stochastic, deterministic };
+// Aggregated devices are grouped by equal coefficients into classes. Only
+// valid for stochastic law without per source job sizes, since it relies on
+// identical exponential processing times.
+enum class DeviceGrouping { individual, aggregated };
+// Poisson sources make requests with exponential intervals, which have their
+// period as a mean. Merged ones share a few arrival streams, one per sources
+// with periods within a factor of two, thinned to the rate of each source.
+enum class SourceArrivals { periodic, poisson, mergedPoisson };
 class Simulator final : public smo::SimulatorBase {
  public:
   Simulator(std::vector<smo::Time> source_periods,
             std::vector<double> device_coefficients,
             std::size_t buffer_capacity, std::size_t target_amount_of_requests,
             SimulatorLaw law);
-  Simulator(SimulatorConfig config, SimulatorLaw law);
+  // Simulation state and indexes of the buffer and device policies are
+  // allocated from `resource`, which must outlive the simulator.
+  Simulator(SimulatorConfig config, SimulatorLaw law,
+            DeviceGrouping grouping = DeviceGrouping::individual,
+            SourceArrivals arrivals = SourceArrivals::periodic,
+            std::pmr::memory_resource* resource =
+                std::pmr::get_default_resource());
 
   void Reset() override;
-  std::vector<smo::Request> FakeBuffer() const;
-  const std::vector<std::deque<Request>>& RealBuffer() const;
-  std::size_t current_packet() const;
+  // Makes runs reproducible. Resets the simulation.
+  void Seed(std::uint64_t seed);
+  // Replays intervals between arrivals and service demands of requests of
+  // each source, which multiply device coefficients. When a stream runs out,
+  // or is absent, the synthetic law is used. Either trace may be nullptr.
+  // Resets the simulation.
+  void UseTraces(std::shared_ptr<const Trace> arrival_trace,
+                 std::shared_ptr<const Trace> service_trace);
+  // Buffered requests in order of their arrival.
+  BufferStorage::Range FakeBuffer() const;
+  const BufferStorage& RealBuffer() const;
+  // Packet, that is being served, if buffer discipline has packets.
+  std::optional<std::size_t> current_packet() const;
 
  protected:
   std::optional<Request> PutInBuffer(Request request) override;
@@ -31,20 +62,44 @@ class Simulator final : public smo::SimulatorBase {
   Time DeviceProcessingTime(std::size_t device_id,
                             const Request& request) override;
   smo::Time SourcePeriod(std::size_t source_id) override;
+  std::size_t BatchSize(std::size_t source_id) override;
+  double ProcessingTimeDerivative(std::size_t device_id,
+                                  Time processing_time) override;
+  double SourcePeriodScore(std::size_t source_id, Time period) override;
+  void OnDeviceRelease(std::size_t device_id) override;
+  Time DeviceClassPeriod(std::size_t class_id, std::size_t busy) override;
+  std::size_t PickServedRequest(std::size_t class_id,
+                                std::size_t amount) override;
+  GroupArrival NextGroupArrival(std::size_t group_id) override;
 
  private:
   void Init();
+  void GroupSourcesByPeriod();
+  // Rounds up with probability of the fractional part, so that short random
+  // times are not biased towards zero.
+  Time RoundTime(double time);
 
   SimulatorLaw law_;
+  SourceArrivals arrivals_;
   std::mt19937 random_gen_;
   std::exponential_distribution<> distribution_{1.0};
-  std::vector<smo::Time> source_periods_;
-  std::vector<double> device_coefficients_;
-  std::vector<std::deque<Request>> storage_;
-  std::size_t buffer_capacity_ = 0;
-  std::size_t buffer_size_ = 0;
-  std::size_t current_packet_ = 0;
-  std::vector<smo::DeviceStatistics>::const_iterator next_device_pointer_;
+  std::uniform_real_distribution<> fraction_distribution_{0.0, 1.0};
+  std::span<const smo::Time> source_periods_;
+  std::span<const double> device_coefficients_;
+  std::span<const double> source_job_sizes_;
+  std::span<const double> source_batch_sizes_;
+  std::shared_ptr<const void> config_storage_;
+  std::pmr::vector<SpecialEvent> initial_events_;
+  BufferStorage storage_;
+  std::unique_ptr<BufferPolicy> buffer_policy_;
+  // Null, if devices are aggregated.
+  std::unique_ptr<DevicePolicy> device_policy_;
+  std::vector<double> class_coefficients_;
+  std::vector<std::vector<std::size_t>> group_sources_;
+  std::vector<smo::Time> group_min_periods_;
+  std::shared_ptr<const Trace> arrival_trace_;
+  std::shared_ptr<const Trace> service_trace_;
+  std::pmr::vector<std::size_t> arrival_positions_;
 };
 }  // namespace smo
 #endif
@@ -1,19 +1,124 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <ios>
 #include <istream>
+#include <limits>
 #include <map>
+#include <memory>
+#include <ostream>
+#include <span>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <utility>
+#include <vector>
 
+#include "mapped_file.h"
 #include "simulator_config.h"
 
+namespace {
+struct ConfigArrays {
+  std::vector<smo::Time> source_periods;
+  std::vector<double> device_coefficients;
+  std::vector<double> source_weights;
+  std::vector<double> source_job_sizes;
+  std::vector<double> source_batch_sizes;
+};
+struct BinaryConfigHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t buffer_capacity;
+  std::uint64_t target_amount_of_requests;
+  std::uint64_t sources_amount;
+  std::uint64_t devices_amount;
+  // Since version 2.
+  std::uint64_t buffer_discipline;
+  std::uint64_t weights_amount;
+  std::uint64_t job_sizes_amount;
+  // Since version 3.
+  std::uint64_t device_selection;
+  // Since version 4.
+  std::uint64_t batch_sizes_amount;
+};
+}  // namespace
+
+static constexpr char binaryConfigMagic[4] = {'S', 'M', 'O', 'C'};
+static constexpr std::uint32_t binaryConfigVersion = 4;
+static constexpr std::size_t binaryConfigHeaderSizes[] = {
+    offsetof(BinaryConfigHeader, buffer_discipline),
+    offsetof(BinaryConfigHeader, device_selection),
+    offsetof(BinaryConfigHeader, batch_sizes_amount),
+    sizeof(BinaryConfigHeader),
+};
+
+static const std::map<std::string, smo::BufferDiscipline, std::less<>>
+    disciplineNames{
+        {"packet", smo::BufferDiscipline::packet},
+        {"fifo", smo::BufferDiscipline::fifo},
+        {"lifo", smo::BufferDiscipline::lifo},
+        {"edf", smo::BufferDiscipline::earliestDeadline},
+        {"sjf", smo::BufferDiscipline::shortestJob},
+        {"wfq", smo::BufferDiscipline::weightedFair},
+    };
+static const std::map<std::string, smo::DeviceSelection, std::less<>>
+    selectionNames{
+        {"roundrobin", smo::DeviceSelection::roundRobin},
+        {"fastest", smo::DeviceSelection::fastest},
+        {"leastused", smo::DeviceSelection::leastUsed},
+        {"random", smo::DeviceSelection::random},
+    };
+
+smo::SimulatorConfig smo::MakeSimulatorConfig(
+    std::size_t buffer_capacity, std::size_t target_amount_of_requests,
+    std::vector<smo::Time> source_periods,
+    std::vector<double> device_coefficients, std::vector<double> source_weights,
+    std::vector<double> source_job_sizes,
+    std::vector<double> source_batch_sizes) {
+  auto arrays = std::make_shared<ConfigArrays>(ConfigArrays{
+      std::move(source_periods),
+      std::move(device_coefficients),
+      std::move(source_weights),
+      std::move(source_job_sizes),
+      std::move(source_batch_sizes),
+  });
+  SimulatorConfig config;
+  config.buffer_capacity = buffer_capacity;
+  config.target_amount_of_requests = target_amount_of_requests;
+  config.source_periods = arrays->source_periods;
+  config.device_coefficients = arrays->device_coefficients;
+  config.source_weights = arrays->source_weights;
+  config.source_job_sizes = arrays->source_job_sizes;
+  config.source_batch_sizes = arrays->source_batch_sizes;
+  config.storage = std::move(arrays);
+  return config;
+}
+
 std::istream &smo::operator>>(std::istream &in, SimulatorConfig &config) {
   std::istream::sentry sentry(in);
   if (!sentry) {
     return in;
   }
+  std::vector<smo::Time> source_periods;
+  std::vector<double> device_coefficients;
+  std::vector<double> source_weights;
+  std::vector<double> source_job_sizes;
+  std::vector<double> source_batch_sizes;
+  auto ReadDoubles = [&](std::vector<double>& numbers) {
+    double result = 0.0;
+    in >> result;
+    while (in) {
+      numbers.push_back(result);
+      in >> result;
+    }
+    in.clear();
+  };
+  auto discipline = BufferDiscipline::packet;
+  auto selection = DeviceSelection::roundRobin;
   std::map<std::string, std::function<void()>> headers{
       {"Requests:", [&] { in >> config.target_amount_of_requests; }},
       {"Buffer:", [&] { in >> config.buffer_capacity; }},
@@ -22,33 +127,352 @@ std::istream &smo::operator>>(std::istream &in, SimulatorConfig &config) {
          std::uint64_t result = 0;
          in >> result;
          while (in) {
-           config.source_periods.push_back(result);
+           source_periods.push_back(result);
            in >> result;
          }
          in.clear();
        }},
-      {"Devices:",
+      {"Devices:", [&] { ReadDoubles(device_coefficients); }},
+      {"Discipline:",
        [&] {
-         double result = 0.0;
-         in >> result;
-         while (in) {
-           config.device_coefficients.push_back(result);
-           in >> result;
+         std::string name;
+         in >> name;
+         auto matched_name = disciplineNames.find(name);
+         if (matched_name != disciplineNames.end()) {
+           discipline = matched_name->second;
+         } else {
+           in.setstate(std::ios_base::failbit);
+         }
+       }},
+      {"Selection:",
+       [&] {
+         std::string name;
+         in >> name;
+         auto matched_name = selectionNames.find(name);
+         if (matched_name != selectionNames.end()) {
+           selection = matched_name->second;
+         } else {
+           in.setstate(std::ios_base::failbit);
          }
-         in.clear();
        }},
+      {"Weights:", [&] { ReadDoubles(source_weights); }},
+      {"Sizes:", [&] { ReadDoubles(source_job_sizes); }},
+      {"Batches:", [&] { ReadDoubles(source_batch_sizes); }},
   };
   std::string header;
-  while (in && headers.size() != 0) {
-    in >> header;
+  while (in >> header) {
     auto matched_header = headers.find(header);
     if (matched_header != headers.end()) {
       matched_header->second();
       headers.erase(matched_header);
     } else {
       in.setstate(std::ios_base::failbit);
+      return in;
     }
   }
-
+  // Running out of headers is fine, unless some of the required are missing.
+  bool has_required_headers =
+      headers.count("Requests:") + headers.count("Buffer:") +
+          headers.count("Sources:") + headers.count("Devices:") ==
+      0;
+  if (in.eof() && has_required_headers) {
+    in.clear(std::ios_base::eofbit);
+  }
+  config = MakeSimulatorConfig(
+      config.buffer_capacity, config.target_amount_of_requests,
+      std::move(source_periods), std::move(device_coefficients),
+      std::move(source_weights), std::move(source_job_sizes),
+      std::move(source_batch_sizes));
+  config.buffer_discipline = discipline;
+  config.device_selection = selection;
   return in;
 }
+
+template <typename Value>
+static const std::string& NameOf(
+    const std::map<std::string, Value, std::less<>>& names, Value value) {
+  return std::find_if(names.begin(), names.end(),
+                      [&](const auto& name) { return name.second == value; })
+      ->first;
+}
+template <typename T>
+static void WriteValues(std::ostream& out, const char* header,
+                        std::span<const T> values) {
+  if (values.empty()) {
+    return;
+  }
+  out << header;
+  for (auto value : values) {
+    out << ' ' << value;
+  }
+  out << '\n';
+}
+std::ostream& smo::operator<<(std::ostream& out,
+                              const SimulatorConfig& config) {
+  auto precision = out.precision(std::numeric_limits<double>::max_digits10);
+  out << "Requests: " << config.target_amount_of_requests << '\n';
+  out << "Buffer: " << config.buffer_capacity << '\n';
+  WriteValues(out, "Sources:", config.source_periods);
+  WriteValues(out, "Devices:", config.device_coefficients);
+  out << "Discipline: " << NameOf(disciplineNames, config.buffer_discipline)
+      << '\n';
+  out << "Selection: " << NameOf(selectionNames, config.device_selection)
+      << '\n';
+  WriteValues(out, "Weights:", config.source_weights);
+  WriteValues(out, "Sizes:", config.source_job_sizes);
+  WriteValues(out, "Batches:", config.source_batch_sizes);
+  out.precision(precision);
+  return out;
+}
+
+namespace {
+// Whitespace separated tokens of the text config.
+class Tokenizer {
+ public:
+  Tokenizer(const char* begin, const char* end) : current_(begin), end_(end) {}
+
+  std::string_view Next() {
+    SkipSpaces();
+    auto begin = current_;
+    while (current_ != end_ && !IsSpace(*current_)) {
+      ++current_;
+    }
+    return std::string_view(begin, current_ - begin);
+  }
+  // Parses the next token as a number. Leaves the token in place on failure.
+  template <typename T>
+  bool NextNumber(T& value) {
+    SkipSpaces();
+    auto [ptr, error] = std::from_chars(current_, end_, value);
+    if (error != std::errc() || (ptr != end_ && !IsSpace(*ptr))) {
+      return false;
+    }
+    current_ = ptr;
+    return true;
+  }
+  // Counts numbers before the next header, so that arrays are allocated once.
+  std::size_t CountNumbers() const {
+    std::size_t result = 0;
+    auto current = current_;
+    while (true) {
+      while (current != end_ && IsSpace(*current)) {
+        ++current;
+      }
+      if (current == end_ || !IsNumberStart(*current)) {
+        return result;
+      }
+      while (current != end_ && !IsSpace(*current)) {
+        ++current;
+      }
+      result += 1;
+    }
+  }
+  bool at_end() {
+    SkipSpaces();
+    return current_ == end_;
+  }
+
+ private:
+  static bool IsSpace(char symbol) {
+    return std::isspace(static_cast<unsigned char>(symbol));
+  }
+  static bool IsNumberStart(char symbol) {
+    return std::isdigit(static_cast<unsigned char>(symbol)) || symbol == '-' ||
+           symbol == '.';
+  }
+  void SkipSpaces() {
+    while (current_ != end_ && IsSpace(*current_)) {
+      ++current_;
+    }
+  }
+
+  const char* current_;
+  const char* end_;
+};
+}  // namespace
+
+template <typename T>
+static void ReadNumbers(Tokenizer& tokenizer, std::vector<T>& numbers) {
+  numbers.reserve(tokenizer.CountNumbers());
+  T value{};
+  while (tokenizer.NextNumber(value)) {
+    numbers.push_back(value);
+  }
+}
+
+static bool ReadTextConfig(const smo::MappedFile& file,
+                           smo::SimulatorConfig& config) {
+  file.AdviseSequential();
+  Tokenizer tokenizer(file.data(), file.data() + file.size());
+  std::vector<smo::Time> source_periods;
+  std::vector<double> device_coefficients;
+  std::vector<double> source_weights;
+  std::vector<double> source_job_sizes;
+  std::vector<double> source_batch_sizes;
+  auto discipline = smo::BufferDiscipline::packet;
+  auto selection = smo::DeviceSelection::roundRobin;
+  bool has_requests = false;
+  bool has_buffer = false;
+  bool has_sources = false;
+  bool has_devices = false;
+  bool has_discipline = false;
+  bool has_selection = false;
+  bool has_weights = false;
+  bool has_job_sizes = false;
+  bool has_batch_sizes = false;
+  while (!tokenizer.at_end()) {
+    auto header = tokenizer.Next();
+    if (header == "Requests:" && !has_requests) {
+      has_requests = tokenizer.NextNumber(config.target_amount_of_requests);
+      if (!has_requests) {
+        return false;
+      }
+    } else if (header == "Buffer:" && !has_buffer) {
+      has_buffer = tokenizer.NextNumber(config.buffer_capacity);
+      if (!has_buffer) {
+        return false;
+      }
+    } else if (header == "Sources:" && !has_sources) {
+      ReadNumbers(tokenizer, source_periods);
+      has_sources = true;
+    } else if (header == "Devices:" && !has_devices) {
+      ReadNumbers(tokenizer, device_coefficients);
+      has_devices = true;
+    } else if (header == "Discipline:" && !has_discipline) {
+      auto matched_name = disciplineNames.find(tokenizer.Next());
+      if (matched_name == disciplineNames.end()) {
+        return false;
+      }
+      discipline = matched_name->second;
+      has_discipline = true;
+    } else if (header == "Selection:" && !has_selection) {
+      auto matched_name = selectionNames.find(tokenizer.Next());
+      if (matched_name == selectionNames.end()) {
+        return false;
+      }
+      selection = matched_name->second;
+      has_selection = true;
+    } else if (header == "Weights:" && !has_weights) {
+      ReadNumbers(tokenizer, source_weights);
+      has_weights = true;
+    } else if (header == "Sizes:" && !has_job_sizes) {
+      ReadNumbers(tokenizer, source_job_sizes);
+      has_job_sizes = true;
+    } else if (header == "Batches:" && !has_batch_sizes) {
+      ReadNumbers(tokenizer, source_batch_sizes);
+      has_batch_sizes = true;
+    } else {
+      return false;
+    }
+  }
+  if (!(has_requests && has_buffer && has_sources && has_devices)) {
+    return false;
+  }
+  config = smo::MakeSimulatorConfig(
+      config.buffer_capacity, config.target_amount_of_requests,
+      std::move(source_periods), std::move(device_coefficients),
+      std::move(source_weights), std::move(source_job_sizes),
+      std::move(source_batch_sizes));
+  config.buffer_discipline = discipline;
+  config.device_selection = selection;
+  return true;
+}
+
+template <typename T>
+static std::span<const T> TakeArray(const char*& current, std::size_t amount) {
+  std::span<const T> result(reinterpret_cast<const T*>(current), amount);
+  current += result.size_bytes();
+  return result;
+}
+
+static bool ReadBinaryConfig(std::shared_ptr<const smo::MappedFile> file,
+                             smo::SimulatorConfig& config) {
+  BinaryConfigHeader header{};
+  if (file->size() < binaryConfigHeaderSizes[0]) {
+    return false;
+  }
+  std::memcpy(&header, file->data(), binaryConfigHeaderSizes[0]);
+  if (header.version == 0 || header.version > binaryConfigVersion) {
+    return false;
+  }
+  std::size_t header_size = binaryConfigHeaderSizes[header.version - 1];
+  if (file->size() < header_size) {
+    return false;
+  }
+  std::memcpy(&header, file->data(), header_size);
+  // Every array has 8-byte elements.
+  const std::uint64_t max_elements = file->size() / 8;
+  if (header.sources_amount > max_elements ||
+      header.devices_amount > max_elements ||
+      header.weights_amount > max_elements ||
+      header.job_sizes_amount > max_elements ||
+      header.batch_sizes_amount > max_elements ||
+      header.buffer_discipline >= disciplineNames.size() ||
+      header.device_selection >= selectionNames.size() ||
+      file->size() != header_size + 8 * (header.sources_amount +
+                                         header.devices_amount +
+                                         header.weights_amount +
+                                         header.job_sizes_amount +
+                                         header.batch_sizes_amount)) {
+    return false;
+  }
+  const char* current = file->data() + header_size;
+  config.buffer_capacity = header.buffer_capacity;
+  config.target_amount_of_requests = header.target_amount_of_requests;
+  config.source_periods = TakeArray<smo::Time>(current, header.sources_amount);
+  config.device_coefficients =
+      TakeArray<double>(current, header.devices_amount);
+  config.buffer_discipline =
+      static_cast<smo::BufferDiscipline>(header.buffer_discipline);
+  config.device_selection =
+      static_cast<smo::DeviceSelection>(header.device_selection);
+  config.source_weights = TakeArray<double>(current, header.weights_amount);
+  config.source_job_sizes =
+      TakeArray<double>(current, header.job_sizes_amount);
+  config.source_batch_sizes =
+      TakeArray<double>(current, header.batch_sizes_amount);
+  config.storage = std::move(file);
+  return true;
+}
+
+bool smo::ReadSimulatorConfig(const std::string& path,
+                              SimulatorConfig& config) {
+  auto file = MappedFile::Open(path);
+  if (file == nullptr) {
+    return false;
+  }
+  if (file->size() >= sizeof(binaryConfigMagic) &&
+      std::memcmp(file->data(), binaryConfigMagic,
+                  sizeof(binaryConfigMagic)) == 0) {
+    return ReadBinaryConfig(std::move(file), config);
+  }
+  return ReadTextConfig(*file, config);
+}
+
+template <typename T>
+static void WriteArray(std::ostream& out, std::span<const T> array) {
+  out.write(reinterpret_cast<const char*>(array.data()), array.size_bytes());
+}
+
+void smo::WriteBinaryConfig(std::ostream& out, const SimulatorConfig& config) {
+  BinaryConfigHeader header{
+      {},
+      binaryConfigVersion,
+      config.buffer_capacity,
+      config.target_amount_of_requests,
+      config.source_periods.size(),
+      config.device_coefficients.size(),
+      static_cast<std::uint64_t>(config.buffer_discipline),
+      config.source_weights.size(),
+      config.source_job_sizes.size(),
+      static_cast<std::uint64_t>(config.device_selection),
+      config.source_batch_sizes.size(),
+  };
+  std::memcpy(header.magic, binaryConfigMagic, sizeof(header.magic));
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  WriteArray(out, config.source_periods);
+  WriteArray(out, config.device_coefficients);
+  WriteArray(out, config.source_weights);
+  WriteArray(out, config.source_job_sizes);
+  WriteArray(out, config.source_batch_sizes);
+}
@@ -4,18 +4,69 @@
 #include <chrono>
 #include <cstddef>
 #include <iosfwd>
+#include <memory>
 #include <random>
+#include <span>
+#include <string>
 #include <vector>
 
 #include "../smo_components.h"
 
 namespace smo {
+enum class BufferDiscipline {
+  // Drop the oldest request of the lowest priority packet,
+  // serve packet by packet.
+  packet,
+  fifo,
+  lifo,
+  earliestDeadline,
+  shortestJob,
+  weightedFair,
+};
+enum class DeviceSelection {
+  roundRobin,
+  fastest,
+  leastUsed,
+  random,
+};
 struct SimulatorConfig {
-  std::size_t buffer_capacity;
-  std::size_t target_amount_of_requests;
-  std::vector<smo::Time> source_periods;
-  std::vector<double> device_coefficients;
+  std::size_t buffer_capacity = 0;
+  std::size_t target_amount_of_requests = 0;
+  std::span<const smo::Time> source_periods;
+  std::span<const double> device_coefficients;
+  BufferDiscipline buffer_discipline = BufferDiscipline::packet;
+  DeviceSelection device_selection = DeviceSelection::roundRobin;
+  // Optional, one per source. Empty spans mean all ones.
+  std::span<const double> source_weights;
+  std::span<const double> source_job_sizes;
+  // Mean amount of requests made at once, at least one.
+  std::span<const double> source_batch_sizes;
+  // Keeps arrays behind the spans alive. It's either parsed vectors or
+  // a memory-mapped binary config.
+  std::shared_ptr<const void> storage;
 };
+SimulatorConfig MakeSimulatorConfig(
+    std::size_t buffer_capacity, std::size_t target_amount_of_requests,
+    std::vector<smo::Time> source_periods,
+    std::vector<double> device_coefficients,
+    std::vector<double> source_weights = {},
+    std::vector<double> source_job_sizes = {},
+    std::vector<double> source_batch_sizes = {});
 std::istream& operator>>(std::istream& in, SimulatorConfig& config);
+// Text format, which operator>> reads back.
+std::ostream& operator<<(std::ostream& out, const SimulatorConfig& config);
+// Maps the file and reads either the text format, or the binary one, which
+// is used in place without copying. Returns false on error.
+bool ReadSimulatorConfig(const std::string& path, SimulatorConfig& config);
+// Binary config in native byte order:
+//   char[4] "SMOC", u32 version, u64 buffer capacity,
+//   u64 target amount of requests, u64 sources, u64 devices,
+//   u64 buffer discipline, u64 weights, u64 job sizes, u64 device selection,
+//   u64 batch sizes, u64 source periods[sources],
+//   f64 device coefficients[devices], f64 source weights[weights],
+//   f64 source job sizes[job sizes], f64 source batch sizes[batch sizes].
+// Older versions end the header earlier: version 1 after devices,
+// version 2 after job sizes, version 3 after device selection.
+void WriteBinaryConfig(std::ostream& out, const SimulatorConfig& config);
 }  // namespace smo
 #endif
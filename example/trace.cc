@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+static constexpr char binaryTraceMagic[4] = {'S', 'M', 'O', 'T'};
+static constexpr std::uint32_t binaryTraceVersion = 1;
+// Amount of values, which is read ahead of the stream position.
+static constexpr std::size_t readaheadWindow = 1 << 13;
+
+namespace {
+struct BinaryTraceHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t streams_amount;
+};
+}  // namespace
+
+std::shared_ptr<const smo::Trace> smo::Trace::Open(const std::string& path) {
+  auto file = MappedFile::Open(path);
+  if (file == nullptr) {
+    return nullptr;
+  }
+  std::shared_ptr<Trace> trace(new Trace());
+  bool is_read = false;
+  if (file->size() >= sizeof(binaryTraceMagic) &&
+      std::memcmp(file->data(), binaryTraceMagic,
+                  sizeof(binaryTraceMagic)) == 0) {
+    is_read = trace->ReadBinary(std::move(file));
+  } else {
+    is_read = trace->ReadText(*file);
+  }
+  // Values become times, so they must be finite and non-negative.
+  if (!is_read ||
+      !std::all_of(trace->values_.begin(), trace->values_.end(),
+                   [](double value) {
+                     return std::isfinite(value) && value >= 0;
+                   })) {
+    return nullptr;
+  }
+  return trace;
+}
+
+bool smo::Trace::ReadBinary(std::shared_ptr<const MappedFile> file) {
+  BinaryTraceHeader header{};
+  if (file->size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, file->data(), sizeof(header));
+  // Every array has 8-byte elements. The offsets table must fit behind the
+  // header before any of it is read.
+  const std::uint64_t max_elements = (file->size() - sizeof(header)) / 8;
+  if (header.version != binaryTraceVersion ||
+      header.streams_amount >= max_elements) {
+    return false;
+  }
+  const char* current = file->data() + sizeof(header);
+  offsets_ = std::span<const std::uint64_t>(
+      reinterpret_cast<const std::uint64_t*>(current),
+      header.streams_amount + 1);
+  current += offsets_.size_bytes();
+  if (offsets_.front() != 0 ||
+      offsets_.back() > max_elements - offsets_.size() ||
+      file->size() !=
+          sizeof(header) + 8 * (offsets_.size() + offsets_.back())) {
+    return false;
+  }
+  for (std::size_t i = 1; i < offsets_.size(); ++i) {
+    if (offsets_[i] < offsets_[i - 1]) {
+      return false;
+    }
+  }
+  values_ = std::span<const double>(reinterpret_cast<const double*>(current),
+                                    offsets_.back());
+  file_ = std::move(file);
+  return true;
+}
+
+bool smo::Trace::ReadText(const MappedFile& file) {
+  file.AdviseSequential();
+  const char* current = file.data();
+  const char* end = file.data() + file.size();
+  parsed_offsets_.push_back(0);
+  while (current != end) {
+    const char* line_end =
+        static_cast<const char*>(std::memchr(current, '\n', end - current));
+    if (line_end == nullptr) {
+      line_end = end;
+    }
+    while (current != line_end) {
+      if (std::isspace(static_cast<unsigned char>(*current))) {
+        ++current;
+        continue;
+      }
+      double value = 0.0;
+      auto [ptr, error] = std::from_chars(current, line_end, value);
+      if (error != std::errc() ||
+          (ptr != line_end &&
+           !std::isspace(static_cast<unsigned char>(*ptr)))) {
+        return false;
+      }
+      parsed_values_.push_back(value);
+      current = ptr;
+    }
+    parsed_offsets_.push_back(parsed_values_.size());
+    if (current != end) {
+      ++current;
+    }
+  }
+  offsets_ = parsed_offsets_;
+  values_ = parsed_values_;
+  return true;
+}
+
+std::optional<double> smo::Trace::At(std::size_t stream_id,
+                                     std::size_t position) const {
+  if (stream_id >= streams_amount()) {
+    return std::nullopt;
+  }
+  auto stream = Stream(stream_id);
+  if (position >= stream.size()) {
+    return std::nullopt;
+  }
+  if (file_ != nullptr && position % readaheadWindow == 0) {
+    // The next window is requested, while the current one is read.
+    auto ahead =
+        stream.subspan(std::min(position + readaheadWindow, stream.size()));
+    if (!ahead.empty()) {
+      file_->AdviseWillNeed(
+          reinterpret_cast<const char*>(ahead.data()),
+          std::min(ahead.size(), readaheadWindow) * sizeof(double));
+    }
+  }
+  return stream[position];
+}
+
+std::span<const double> smo::Trace::Stream(std::size_t stream_id) const {
+  return values_.subspan(offsets_[stream_id],
+                         offsets_[stream_id + 1] - offsets_[stream_id]);
+}
+
+std::size_t smo::Trace::streams_amount() const {
+  return offsets_.empty() ? 0 : offsets_.size() - 1;
+}
@@ -0,0 +1,49 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace smo {
+// Recorded sequences of numbers, one stream per source, such as intervals
+// between arrivals or service demands of requests.
+class Trace {
+ public:
+  // Maps the file and reads either the text format, with one line of
+  // whitespace separated numbers per stream, or the binary one, which is
+  // used in place without copying. Binary trace in native byte order:
+  //   char[4] "SMOT", u32 version, u64 streams, u64 offsets[streams + 1],
+  //   f64 values[offsets[streams]],
+  // where stream i is values[offsets[i]] up to values[offsets[i + 1]].
+  // Returns nullptr on error.
+  static std::shared_ptr<const Trace> Open(const std::string& path);
+  Trace(const Trace&) = delete;
+  Trace& operator=(const Trace&) = delete;
+
+  // Value at `position` of the stream, or nullopt, if the stream is shorter.
+  // Hints the system to read ahead, when position crosses a window boundary.
+  std::optional<double> At(std::size_t stream_id, std::size_t position) const;
+  std::span<const double> Stream(std::size_t stream_id) const;
+  std::size_t streams_amount() const;
+
+ private:
+  Trace() = default;
+  bool ReadText(const MappedFile& file);
+  bool ReadBinary(std::shared_ptr<const MappedFile> file);
+
+  std::span<const std::uint64_t> offsets_;
+  std::span<const double> values_;
+  // Either the mapped binary trace, or values parsed from the text one.
+  std::shared_ptr<const MappedFile> file_;
+  std::vector<std::uint64_t> parsed_offsets_;
+  std::vector<double> parsed_values_;
+};
+}  // namespace smo
+#endif
@@ -0,0 +1,125 @@
+#ifndef INDEXED_HEAP_H_
+#define INDEXED_HEAP_H_
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory_resource>
+#include <vector>
+
+namespace smo {
+// Binary heap of slots from [0, capacity), each with its own key. Unlike
+// std::priority_queue, any slot can be removed or given a new key.
+// Slots with equivalent keys are ordered by id. All operations are O(log n).
+template <typename Key, typename Compare = std::less<Key>>
+class IndexedHeap {
+ public:
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  explicit IndexedHeap(std::size_t capacity = 0, Compare compare = Compare(),
+                       std::pmr::memory_resource* resource =
+                           std::pmr::get_default_resource())
+      : compare_(compare),
+        heap_(resource),
+        positions_(capacity, npos, resource),
+        keys_(capacity, resource) {
+    heap_.reserve(capacity);
+  }
+
+  // Empties the heap and changes its capacity.
+  void Reset(std::size_t capacity) {
+    heap_.clear();
+    heap_.reserve(capacity);
+    positions_.assign(capacity, npos);
+    keys_.assign(capacity, Key());
+  }
+
+  // `slot` must not be in the heap.
+  void Push(std::size_t slot, Key key) {
+    keys_[slot] = key;
+    heap_.push_back(slot);
+    positions_[slot] = heap_.size() - 1;
+    SiftUp(heap_.size() - 1);
+  }
+  // `slot` must be in the heap.
+  void Update(std::size_t slot, Key key) {
+    keys_[slot] = key;
+    SiftUp(positions_[slot]);
+    SiftDown(positions_[slot]);
+  }
+  // `slot` must be in the heap.
+  void Remove(std::size_t slot) {
+    auto position = positions_[slot];
+    positions_[slot] = npos;
+    auto last = heap_.back();
+    heap_.pop_back();
+    if (position == heap_.size()) {
+      return;
+    }
+    Place(position, last);
+    SiftUp(position);
+    SiftDown(positions_[last]);
+  }
+  void Clear() {
+    for (auto slot : heap_) {
+      positions_[slot] = npos;
+    }
+    heap_.clear();
+  }
+  bool Contains(std::size_t slot) const { return positions_[slot] != npos; }
+  bool empty() const { return heap_.empty(); }
+  std::size_t top() const { return heap_.front(); }
+  const Key& key(std::size_t slot) const { return keys_[slot]; }
+
+ private:
+  bool IsBefore(std::size_t lhs_slot, std::size_t rhs_slot) const {
+    const auto& lhs = keys_[lhs_slot];
+    const auto& rhs = keys_[rhs_slot];
+    if (compare_(lhs, rhs)) {
+      return true;
+    }
+    return !compare_(rhs, lhs) && lhs_slot < rhs_slot;
+  }
+  void Place(std::size_t position, std::size_t slot) {
+    heap_[position] = slot;
+    positions_[slot] = position;
+  }
+  void SiftUp(std::size_t position) {
+    auto slot = heap_[position];
+    while (position > 0) {
+      auto parent = (position - 1) / 2;
+      if (!IsBefore(slot, heap_[parent])) {
+        break;
+      }
+      Place(position, heap_[parent]);
+      position = parent;
+    }
+    Place(position, slot);
+  }
+  void SiftDown(std::size_t position) {
+    auto slot = heap_[position];
+    while (true) {
+      auto child = 2 * position + 1;
+      if (child >= heap_.size()) {
+        break;
+      }
+      if (child + 1 < heap_.size() &&
+          IsBefore(heap_[child + 1], heap_[child])) {
+        child += 1;
+      }
+      if (!IsBefore(heap_[child], slot)) {
+        break;
+      }
+      Place(position, heap_[child]);
+      position = child;
+    }
+    Place(position, slot);
+  }
+
+  Compare compare_;
+  std::pmr::vector<std::size_t> heap_;
+  std::pmr::vector<std::size_t> positions_;
+  std::pmr::vector<Key> keys_;
+};
+}  // namespace smo
+#endif
@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "network.h"
+#include "smo_components.h"
+
+static smo::Time SaturatingAdd(smo::Time lhs, smo::Time rhs) {
+  return lhs > smo::maxTime - rhs ? smo::maxTime : lhs + rhs;
+}
+
+bool smo::NetworkEventComparator::operator()(const NetworkEvent& lhs,
+                                             const NetworkEvent& rhs) const {
+  if (lhs.planned_time != rhs.planned_time) {
+    return lhs.planned_time > rhs.planned_time;
+  }
+  if (lhs.kind != rhs.kind) {
+    return lhs.kind > rhs.kind;
+  }
+  if (lhs.id != rhs.id) {
+    return lhs.id > rhs.id;
+  }
+  return lhs.sequence > rhs.sequence;
+}
+
+smo::NetworkNode::NetworkNode(std::size_t index, NetworkNodeConfig config,
+                              std::uint64_t seed)
+    : index_(index),
+      config_(std::move(config)),
+      seed_(seed),
+      devices_(
+          std::vector<DeviceStatistics>(config_.device_coefficients.size())),
+      generated_(std::vector<std::size_t>(config_.source_periods.size())) {
+  assert(config_.transfer_delay > 0);
+  Reset();
+}
+
+const smo::NetworkNodeStatistics& smo::NetworkNode::statistics() const {
+  return statistics_;
+}
+const std::vector<smo::DeviceStatistics>&
+smo::NetworkNode::device_statistics() const {
+  return devices_;
+}
+
+void smo::NetworkNode::Reset() {
+  random_gen_.seed(seed_);
+  processing_distribution_.reset();
+  routing_distribution_.reset();
+  events_ = decltype(events_)();
+  buffer_.clear();
+  free_devices_.clear();
+  for (std::size_t i = devices_.size(); i > 0; --i) {
+    free_devices_.push_back(i - 1);
+  }
+  std::fill(devices_.begin(), devices_.end(), DeviceStatistics{});
+  std::fill(generated_.begin(), generated_.end(), 0);
+  current_time_ = 0;
+  statistics_ = NetworkNodeStatistics{};
+  for (auto& input : inputs_) {
+    while (input.queue->Pop().has_value()) {
+    }
+    input.clock = 0;
+  }
+  for (auto& output : outputs_) {
+    output.sequence = 0;
+    output.promised = 0;
+  }
+  for (std::size_t i = 0; i < config_.source_periods.size(); ++i) {
+    events_.push(NetworkEvent{
+        NetworkEventKind::generateNewRequest,
+        config_.source_periods[i],
+        i,
+        0,
+        Request{},
+    });
+  }
+}
+
+smo::Time smo::NetworkNode::NextEventTime() const {
+  return events_.empty() ? maxTime : events_.top().planned_time;
+}
+
+void smo::NetworkNode::ProcessEvent(Network& network) {
+  NetworkEvent event = events_.top();
+  events_.pop();
+  current_time_ = event.planned_time;
+  switch (event.kind) {
+    case NetworkEventKind::generateNewRequest:
+      statistics_.external_arrivals += 1;
+      Accept(Request{event.id, generated_[event.id]++, current_time_});
+      events_.push(NetworkEvent{
+          NetworkEventKind::generateNewRequest,
+          SaturatingAdd(current_time_, config_.source_periods[event.id]),
+          event.id,
+          0,
+          Request{},
+      });
+      break;
+    case NetworkEventKind::deviceRelease: {
+      auto& device = devices_[event.id];
+      auto request = *device.current_request;
+      device.current_request = std::nullopt;
+      device.next_request = maxTime;
+      free_devices_.push_back(event.id);
+      statistics_.served += 1;
+      Route(network, request);
+      if (!buffer_.empty()) {
+        auto next_request = buffer_.front();
+        buffer_.pop_front();
+        statistics_.time_in_buffer +=
+            current_time_ - next_request.generation_time;
+        OccupyDevice(next_request);
+      }
+      break;
+    }
+    case NetworkEventKind::requestArrival:
+      statistics_.routed_arrivals += 1;
+      event.request.generation_time = current_time_;
+      Accept(event.request);
+      break;
+  }
+}
+
+void smo::NetworkNode::Accept(const Request& request) {
+  if (OccupyDevice(request)) {
+    return;
+  }
+  if (buffer_.size() < config_.buffer_capacity) {
+    buffer_.push_back(request);
+  } else {
+    statistics_.rejected += 1;
+  }
+}
+
+bool smo::NetworkNode::OccupyDevice(const Request& request) {
+  if (free_devices_.empty()) {
+    return false;
+  }
+  auto device_id = free_devices_.back();
+  free_devices_.pop_back();
+  auto& device = devices_[device_id];
+  auto processing_time =
+      Time(config_.device_coefficients[device_id] *
+           processing_distribution_(random_gen_));
+  device.current_request = request;
+  device.time_in_usage += processing_time;
+  device.next_request = current_time_ + processing_time;
+  statistics_.time_in_device += processing_time;
+  events_.push(NetworkEvent{
+      NetworkEventKind::deviceRelease,
+      device.next_request,
+      device_id,
+      0,
+      Request{},
+  });
+  return true;
+}
+
+void smo::NetworkNode::Route(Network& network, const Request& request) {
+  if (config_.routes.empty()) {
+    statistics_.departed += 1;
+    return;
+  }
+  double choice = routing_distribution_(random_gen_);
+  for (std::size_t i = 0; i < config_.routes.size(); ++i) {
+    choice -= config_.routes[i].probability;
+    if (choice < 0) {
+      network.Deliver(index_, i, request,
+                      SaturatingAdd(current_time_, config_.transfer_delay));
+      return;
+    }
+  }
+  statistics_.departed += 1;
+}
+
+void smo::NetworkNode::ReceiveMessages() {
+  for (auto& input : inputs_) {
+    while (auto message = input.queue->Pop()) {
+      input.clock = message->time;
+      if (!message->is_null) {
+        events_.push(NetworkEvent{
+            NetworkEventKind::requestArrival,
+            message->time,
+            input.from,
+            message->sequence,
+            message->request,
+        });
+      }
+    }
+  }
+}
+
+smo::Time smo::NetworkNode::SafeTime() const {
+  Time result = maxTime;
+  for (const auto& input : inputs_) {
+    result = std::min(result, input.clock);
+  }
+  return result;
+}
+
+// Nothing, that this node sends from now on, can arrive earlier than its
+// next possible event plus the transfer delay.
+void smo::NetworkNode::SendNullMessages() {
+  auto promise =
+      SaturatingAdd(std::min(NextEventTime(), SafeTime()),
+                    config_.transfer_delay);
+  for (auto& output : outputs_) {
+    if (promise > output.promised) {
+      output.queue->Push(Message{promise, true, 0, Request{}});
+      output.promised = promise;
+    }
+  }
+}
+
+smo::Network::Network(std::vector<NetworkNodeConfig> nodes, Time end_time,
+                      std::uint64_t seed)
+    : end_time_(end_time) {
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    min_transfer_delay_ =
+        std::min(min_transfer_delay_, nodes[i].transfer_delay);
+    nodes_.emplace_back(i, std::move(nodes[i]), seed + i);
+  }
+  for (auto& node : nodes_) {
+    for (const auto& route : node.config_.routes) {
+      assert(route.node < nodes_.size());
+      auto& inputs = nodes_[route.node].inputs_;
+      inputs.push_back(NetworkNode::Input{
+          node.index_,
+          std::make_unique<SpscQueue<NetworkNode::Message>>(),
+      });
+      node.outputs_.push_back(NetworkNode::Output{
+          route.node,
+          inputs.back().queue.get(),
+      });
+    }
+  }
+}
+
+void smo::Network::Run(std::size_t threads_amount) {
+  threads_amount = std::min(threads_amount, nodes_.size());
+  if (threads_amount <= 1) {
+    RunSequential();
+  } else {
+    RunParallel(threads_amount);
+  }
+}
+
+void smo::Network::Reset() {
+  for (auto& node : nodes_) {
+    node.Reset();
+  }
+}
+
+smo::Time smo::Network::end_time() const { return end_time_; }
+std::size_t smo::Network::nodes_amount() const { return nodes_.size(); }
+const smo::NetworkNode& smo::Network::node(std::size_t index) const {
+  return nodes_[index];
+}
+
+// Every request, sent while processing events in [start, start + delay),
+// arrives no earlier than the end of the window, so nodes can process the
+// whole window independently.
+void smo::Network::RunSequential() {
+  while (true) {
+    Time start = maxTime;
+    for (const auto& node : nodes_) {
+      start = std::min(start, node.NextEventTime());
+    }
+    if (start >= end_time_) {
+      break;
+    }
+    Time bound = std::min(end_time_, SaturatingAdd(start, min_transfer_delay_));
+    for (auto& node : nodes_) {
+      while (node.NextEventTime() < bound) {
+        node.ProcessEvent(*this);
+      }
+    }
+  }
+}
+
+void smo::Network::RunParallel(std::size_t threads_amount) {
+  is_parallel_ = true;
+  std::vector<std::thread> threads;
+  threads.reserve(threads_amount - 1);
+  for (std::size_t i = 1; i < threads_amount; ++i) {
+    threads.emplace_back([this, i, threads_amount] {
+      RunPartition(i, threads_amount);
+    });
+  }
+  RunPartition(0, threads_amount);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  is_parallel_ = false;
+}
+
+void smo::Network::RunPartition(std::size_t first_node,
+                                std::size_t threads_amount) {
+  bool is_finished = false;
+  while (!is_finished) {
+    is_finished = true;
+    bool has_progressed = false;
+    for (std::size_t i = first_node; i < nodes_.size(); i += threads_amount) {
+      auto& node = nodes_[i];
+      node.ReceiveMessages();
+      Time bound = std::min(node.SafeTime(), end_time_);
+      while (node.NextEventTime() < bound) {
+        node.ProcessEvent(*this);
+        has_progressed = true;
+      }
+      node.SendNullMessages();
+      if (node.SafeTime() < end_time_ || node.NextEventTime() < end_time_) {
+        is_finished = false;
+      }
+    }
+    if (!has_progressed) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void smo::Network::Deliver(std::size_t from, std::size_t route,
+                           const Request& request, Time time) {
+  if (time >= end_time_) {
+    return;
+  }
+  auto& output = nodes_[from].outputs_[route];
+  if (is_parallel_) {
+    output.queue->Push(
+        NetworkNode::Message{time, false, output.sequence++, request});
+    output.promised = time;
+  } else {
+    nodes_[output.to].events_.push(NetworkEvent{
+        NetworkEventKind::requestArrival,
+        time,
+        from,
+        output.sequence++,
+        request,
+    });
+  }
+}
@@ -0,0 +1,156 @@
+#ifndef NETWORK_H_
+#define NETWORK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "smo_components.h"
+#include "spsc_queue.h"
+
+namespace smo {
+struct NetworkRoute {
+  std::size_t node;
+  double probability;
+};
+struct NetworkNodeConfig {
+  // Periods of sources outside of the network, that feed this node.
+  std::vector<Time> source_periods;
+  // Mean processing times. Processing times are exponentially distributed.
+  std::vector<double> device_coefficients;
+  std::size_t buffer_capacity = 0;
+  // Where served requests go. Probabilities, that don't add up to 1, mean
+  // leaving the network.
+  std::vector<NetworkRoute> routes;
+  // Time to pass a request to another node. Must be positive, because it's
+  // the lookahead, that lets nodes run in parallel.
+  Time transfer_delay = 1;
+};
+struct NetworkNodeStatistics {
+  std::size_t external_arrivals = 0;
+  std::size_t routed_arrivals = 0;
+  std::size_t rejected = 0;
+  std::size_t served = 0;
+  std::size_t departed = 0;
+  Time time_in_buffer = 0;
+  Time time_in_device = 0;
+
+  bool operator==(const NetworkNodeStatistics&) const = default;
+};
+enum class NetworkEventKind {
+  generateNewRequest = 0,
+  deviceRelease = 1,
+  requestArrival = 2,
+};
+struct NetworkEvent {
+  NetworkEventKind kind;
+  Time planned_time;
+  // Source, device or sending node.
+  std::size_t id;
+  // Orders arrivals from the same node at the same time.
+  std::uint64_t sequence;
+  Request request;
+};
+struct NetworkEventComparator {
+  bool operator()(const NetworkEvent& lhs, const NetworkEvent& rhs) const;
+};
+
+class Network;
+// Station of the network: a buffer in front of a pool of devices with its own
+// event calendar. Events are processed in a fixed order of (time, kind, id,
+// sequence), so a node gives the same results regardless of how the network
+// is scheduled.
+class NetworkNode {
+ public:
+  NetworkNode(std::size_t index, NetworkNodeConfig config, std::uint64_t seed);
+  NetworkNode(const NetworkNode&) = delete;
+  NetworkNode& operator=(const NetworkNode&) = delete;
+
+  const NetworkNodeStatistics& statistics() const;
+  const std::vector<DeviceStatistics>& device_statistics() const;
+
+ private:
+  friend class Network;
+  struct Message {
+    Time time = 0;
+    bool is_null = true;
+    std::uint64_t sequence = 0;
+    Request request{};
+  };
+  struct Input {
+    std::size_t from;
+    std::unique_ptr<SpscQueue<Message>> queue;
+    Time clock = 0;
+  };
+  struct Output {
+    std::size_t to;
+    SpscQueue<Message>* queue;
+    std::uint64_t sequence = 0;
+    Time promised = 0;
+  };
+
+  void Reset();
+  Time NextEventTime() const;
+  void ProcessEvent(Network& network);
+  void Accept(const Request& request);
+  bool OccupyDevice(const Request& request);
+  void Route(Network& network, const Request& request);
+  void ReceiveMessages();
+  Time SafeTime() const;
+  void SendNullMessages();
+
+  std::size_t index_;
+  NetworkNodeConfig config_;
+  std::uint64_t seed_;
+  std::mt19937_64 random_gen_;
+  std::exponential_distribution<> processing_distribution_{1.0};
+  std::uniform_real_distribution<> routing_distribution_{0.0, 1.0};
+  std::priority_queue<NetworkEvent, std::vector<NetworkEvent>,
+                      NetworkEventComparator>
+      events_;
+  std::deque<Request> buffer_;
+  std::vector<std::size_t> free_devices_;
+  std::vector<DeviceStatistics> devices_;
+  std::vector<std::size_t> generated_;
+  Time current_time_ = 0;
+  NetworkNodeStatistics statistics_;
+  std::vector<Input> inputs_;
+  std::vector<Output> outputs_;
+};
+
+// Network of stations, simulated until `end_time`. With several threads,
+// nodes are split between them and synchronised conservatively: requests and
+// null messages travel through lock-free queues, and a node only processes
+// events, that no other node can precede anymore. Results are identical to
+// the sequential run.
+class Network {
+ public:
+  Network(std::vector<NetworkNodeConfig> nodes, Time end_time,
+          std::uint64_t seed);
+
+  void Run(std::size_t threads_amount);
+  void Reset();
+  Time end_time() const;
+  std::size_t nodes_amount() const;
+  const NetworkNode& node(std::size_t index) const;
+
+ private:
+  friend class NetworkNode;
+  void RunSequential();
+  void RunParallel(std::size_t threads_amount);
+  void RunPartition(std::size_t first_node, std::size_t threads_amount);
+  void Deliver(std::size_t from, std::size_t route, const Request& request,
+               Time time);
+
+  // Nodes own their input queues, so they never move.
+  std::deque<NetworkNode> nodes_;
+  Time end_time_;
+  Time min_transfer_delay_ = maxTime;
+  bool is_parallel_ = false;
+};
+}  // namespace smo
+#endif
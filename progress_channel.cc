@@ -0,0 +1,88 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "progress_channel.h"
+#include "smo_components.h"
+
+double smo::ProgressSnapshot::Progress() const {
+  return static_cast<double>(current_amount_of_requests) /
+         target_amount_of_requests;
+}
+double smo::ProgressSnapshot::RejectionProbability() const {
+  if (current_amount_of_requests == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(rejected_amount) / current_amount_of_requests;
+}
+
+smo::ProgressChannel::ProgressChannel(std::size_t devices_amount)
+    : devices_amount_(devices_amount),
+      device_usage_(std::make_unique<std::atomic<Time>[]>(devices_amount)) {}
+
+void smo::ProgressChannel::Publish(
+    std::size_t processed_events, std::size_t current_amount_of_requests,
+    std::size_t target_amount_of_requests, std::size_t rejected_amount,
+    Time simulation_time, std::span<const DeviceStatistics> devices) {
+  auto sequence = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  processed_events_.store(processed_events, std::memory_order_relaxed);
+  current_amount_of_requests_.store(current_amount_of_requests,
+                                    std::memory_order_relaxed);
+  target_amount_of_requests_.store(target_amount_of_requests,
+                                   std::memory_order_relaxed);
+  rejected_amount_.store(rejected_amount, std::memory_order_relaxed);
+  simulation_time_.store(simulation_time, std::memory_order_relaxed);
+  for (std::size_t i = 0; i < devices_amount_; ++i) {
+    device_usage_[i].store(devices[i].time_in_usage,
+                           std::memory_order_relaxed);
+  }
+
+  sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+bool smo::ProgressChannel::Read(ProgressSnapshot& snapshot) const {
+  snapshot.device_utilization.resize(devices_amount_);
+  while (true) {
+    auto before = sequence_.load(std::memory_order_acquire);
+    if (before == 0) {
+      return false;
+    }
+    if (before % 2 == 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    snapshot.processed_events =
+        processed_events_.load(std::memory_order_relaxed);
+    snapshot.current_amount_of_requests =
+        current_amount_of_requests_.load(std::memory_order_relaxed);
+    snapshot.target_amount_of_requests =
+        target_amount_of_requests_.load(std::memory_order_relaxed);
+    snapshot.rejected_amount = rejected_amount_.load(std::memory_order_relaxed);
+    snapshot.simulation_time = simulation_time_.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < devices_amount_; ++i) {
+      snapshot.device_utilization[i] = static_cast<double>(
+          device_usage_[i].load(std::memory_order_relaxed));
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) == before) {
+      break;
+    }
+  }
+  // Nothing is used before the first event.
+  for (auto& utilization : snapshot.device_utilization) {
+    utilization = snapshot.simulation_time == 0
+                      ? 0.0
+                      : utilization / snapshot.simulation_time;
+  }
+  return true;
+}
+
+std::size_t smo::ProgressChannel::devices_amount() const {
+  return devices_amount_;
+}
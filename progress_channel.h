@@ -0,0 +1,51 @@
+#ifndef PROGRESS_CHANNEL_H_
+#define PROGRESS_CHANNEL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "smo_components.h"
+
+namespace smo {
+struct ProgressSnapshot {
+  double Progress() const;
+  double RejectionProbability() const;
+
+  std::size_t processed_events = 0;
+  std::size_t current_amount_of_requests = 0;
+  std::size_t target_amount_of_requests = 0;
+  std::size_t rejected_amount = 0;
+  Time simulation_time = 0;
+  std::vector<double> device_utilization;
+};
+// Seqlock, that lets one simulation thread publish its progress, while any
+// amount of monitor threads read it. Publishing never waits for readers.
+class ProgressChannel {
+ public:
+  explicit ProgressChannel(std::size_t devices_amount);
+
+  void Publish(std::size_t processed_events,
+               std::size_t current_amount_of_requests,
+               std::size_t target_amount_of_requests,
+               std::size_t rejected_amount, Time simulation_time,
+               std::span<const DeviceStatistics> devices);
+  // Returns false if nothing was published yet.
+  bool Read(ProgressSnapshot& snapshot) const;
+  std::size_t devices_amount() const;
+
+ private:
+  std::atomic<std::uint64_t> sequence_{0};
+  std::atomic<std::size_t> processed_events_{0};
+  std::atomic<std::size_t> current_amount_of_requests_{0};
+  std::atomic<std::size_t> target_amount_of_requests_{0};
+  std::atomic<std::size_t> rejected_amount_{0};
+  std::atomic<Time> simulation_time_{0};
+  std::size_t devices_amount_;
+  std::unique_ptr<std::atomic<Time>[]> device_usage_;
+};
+}  // namespace smo
+#endif
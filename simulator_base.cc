@@ -1,24 +1,42 @@
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <optional>
+#include <type_traits>
 #include <vector>
 
+#include "progress_channel.h"
 #include "simulator_base.h"
 #include "smo_components.h"
 
 smo::SimulatorBase::SimulatorBase(std::size_t sources_amount,
                                   std::size_t devices_amount,
-                                  std::size_t target_amount_of_requests)
-    : sources_(std::vector<SourceStatistics>(sources_amount)),
-      devices_(std::vector<DeviceStatistics>(devices_amount)),
+                                  std::size_t target_amount_of_requests,
+                                  std::pmr::memory_resource* resource)
+    : sources_(sources_amount, resource),
+      source_groups_(resource),
+      devices_(devices_amount, resource),
+      special_events_(resource),
+      device_classes_(resource),
+      served_requests_(resource),
+      device_class_releases_(0, {}, resource),
       current_amount_of_requests_(0),
       target_amount_of_requests_(target_amount_of_requests),
-      rejected_amount_(0) {}
+      rejected_amount_(0),
+      release_derivatives_(resource),
+      sojourn_derivative_sums_(resource),
+      score_sums_(resource),
+      rejection_weighted_score_sums_(resource) {}
 // If simulation is completed, UB is triggered
 smo::SpecialEvent smo::SimulatorBase::UncheckedStep() {
-  SpecialEvent current_event = special_events_.top();
+  SpecialEvent current_event;
+  if (IsDeviceClassReleaseNext()) {
+    current_event = NextDeviceClassRelease();
+  } else {
+    current_event = special_events_.top();
+    special_events_.pop();
+  }
   current_simulation_time_ = current_event.planned_time;
-  special_events_.pop();
   switch (current_event.kind) {
     case SpecialEventKind::generateNewRequest:
       HandleNewRequestCreation(current_event.id);
@@ -26,9 +44,17 @@ smo::SpecialEvent smo::SimulatorBase::UncheckedStep() {
     case SpecialEventKind::deviceRelease:
       HandleDeviceRelease(current_event.id);
       break;
+    case SpecialEventKind::deviceClassRelease:
+      HandleDeviceClassRelease(current_event.id);
+      break;
     case SpecialEventKind::endOfSimulation:
       break;
   }
+  processed_events_ += 1;
+  if (progress_channel_ != nullptr &&
+      (--events_until_progress_ == 0 || is_completed())) {
+    PublishProgress();
+  }
   return current_event;
 }
 
@@ -39,6 +65,34 @@ smo::SpecialEvent smo::SimulatorBase::Step() {
   return UncheckedStep();
 }
 
+std::size_t smo::SimulatorBase::StepN(std::size_t amount) {
+  std::size_t processed = 0;
+  while (processed < amount && !is_completed()) {
+    UncheckedStep();
+    processed += 1;
+  }
+  return processed;
+}
+
+std::size_t smo::SimulatorBase::StepUntil(Time time) {
+  std::size_t processed = 0;
+  while (HasEventNoLaterThan(time)) {
+    UncheckedStep();
+    processed += 1;
+  }
+  return processed;
+}
+
+std::size_t smo::SimulatorBase::StepBatch(std::span<SpecialEvent> events,
+                                          Time time) {
+  std::size_t processed = 0;
+  while (processed < events.size() && HasEventNoLaterThan(time)) {
+    events[processed] = UncheckedStep();
+    processed += 1;
+  }
+  return processed;
+}
+
 void smo::SimulatorBase::RunToCompletion() {
   if (is_completed()) {
     return;
@@ -48,24 +102,34 @@ void smo::SimulatorBase::RunToCompletion() {
   }
 }
 
+// Statistics are plain data, so filling them with default values compiles
+// down to bulk stores instead of a field by field walk.
+static_assert(std::is_trivially_copyable_v<smo::SourceStatistics>);
+static_assert(std::is_trivially_copyable_v<smo::DeviceStatistics>);
 void smo::SimulatorBase::Reset() {
-  for (auto& s : sources_) {
-    s.generated = 0;
-    s.rejected = 0;
-    s.time_in_device = Time(0);
-    s.time_squared_in_device = 0;
-    s.time_in_buffer = Time(0);
-    s.time_squared_in_buffer = 0;
-  }
-  for (auto& d : devices_) {
-    d.next_request = maxTime;
-    d.current_request = std::nullopt;
-    d.time_in_usage = Time(0);
-  }
+  // Grouped sources have no pending events until their stream picks them.
+  std::fill(sources_.begin(), sources_.end(),
+            SourceStatistics{
+                .next_request = source_groups_.empty() ? Time(0) : maxTime});
+  std::fill(devices_.begin(), devices_.end(), DeviceStatistics{});
   special_events_.clear();
+  for (auto& device_class : device_classes_) {
+    device_class = DeviceClassStatistics{.size = device_class.size};
+  }
+  for (auto& served : served_requests_) {
+    served.clear();
+  }
+  device_class_releases_.Clear();
+  for (auto* values : {&release_derivatives_, &sojourn_derivative_sums_,
+                       &score_sums_, &rejection_weighted_score_sums_}) {
+    std::fill(values->begin(), values->end(), 0.0);
+  }
   current_amount_of_requests_ = 0;
   rejected_amount_ = 0;
+  late_amount_ = 0;
   current_simulation_time_ = Time(0);
+  processed_events_ = 0;
+  events_until_progress_ = progress_period_;
 }
 
 void smo::SimulatorBase::ResetWithNewAmountOfRequests(
@@ -74,10 +138,91 @@ void smo::SimulatorBase::ResetWithNewAmountOfRequests(
   target_amount_of_requests_ = target_amount_of_requests;
 }
 
+void smo::SimulatorBase::AttachProgressChannel(ProgressChannel* channel,
+                                               std::size_t period) {
+  assert(channel == nullptr || (channel->devices_amount() == devices_.size() &&
+                                period > 0));
+  progress_channel_ = channel;
+  progress_period_ = period;
+  events_until_progress_ = period;
+}
+
+void smo::SimulatorBase::PublishProgress() {
+  events_until_progress_ = progress_period_;
+  progress_channel_->Publish(processed_events_, current_amount_of_requests_,
+                             target_amount_of_requests_, rejected_amount_,
+                             current_simulation_time_, devices_);
+}
+
+void smo::SimulatorBase::EnableGradientEstimation(bool is_enabled) {
+  is_estimating_gradients_ = is_enabled;
+  std::size_t devices_amount = is_enabled ? devices_.size() : 0;
+  std::size_t sources_amount = is_enabled ? sources_.size() : 0;
+  release_derivatives_.assign(devices_amount, 0.0);
+  sojourn_derivative_sums_.assign(devices_amount, 0.0);
+  score_sums_.assign(sources_amount, 0.0);
+  rejection_weighted_score_sums_.assign(sources_amount, 0.0);
+  // Initial events are already planned, and their scores are needed too.
+  Reset();
+}
+
+smo::GradientEstimates smo::SimulatorBase::gradient_estimates() const {
+  GradientEstimates result;
+  if (current_amount_of_requests_ == 0) {
+    result.sojourn_by_device_coefficient.assign(
+        sojourn_derivative_sums_.size(), 0.0);
+    result.rejection_by_source_period.assign(score_sums_.size(), 0.0);
+    return result;
+  }
+  double requests = current_amount_of_requests_;
+  for (double sum : sojourn_derivative_sums_) {
+    result.sojourn_by_device_coefficient.push_back(sum / requests);
+  }
+  for (std::size_t i = 0; i < score_sums_.size(); ++i) {
+    result.rejection_by_source_period.push_back(
+        (rejected_amount_ * score_sums_[i] -
+         rejection_weighted_score_sums_[i]) /
+        requests);
+  }
+  return result;
+}
+
+void smo::SimulatorBase::SetWaitThreshold(Time threshold) {
+  wait_threshold_ = threshold;
+}
+std::size_t smo::SimulatorBase::late_amount() const { return late_amount_; }
+
 bool smo::SimulatorBase::is_completed() const {
-  return special_events_.empty();
+  return special_events_.empty() && device_class_releases_.empty();
+}
+
+bool smo::SimulatorBase::IsDeviceClassReleaseNext() const {
+  return !device_class_releases_.empty() &&
+         (special_events_.empty() ||
+          SpecialEventComparator{}(special_events_.top(),
+                                   NextDeviceClassRelease()));
+}
+
+smo::SpecialEvent smo::SimulatorBase::NextDeviceClassRelease() const {
+  auto class_id = device_class_releases_.top();
+  return SpecialEvent{
+      SpecialEventKind::deviceClassRelease,
+      device_class_releases_.key(class_id),
+      class_id,
+  };
 }
 
+bool smo::SimulatorBase::HasEventNoLaterThan(Time time) const {
+  if (IsDeviceClassReleaseNext()) {
+    return NextDeviceClassRelease().planned_time <= time;
+  }
+  return !special_events_.empty() &&
+         special_events_.top().planned_time <= time;
+}
+
+std::size_t smo::SimulatorBase::processed_events() const {
+  return processed_events_;
+}
 std::size_t smo::SimulatorBase::current_amount_of_requests() const {
   return current_amount_of_requests_;
 }
@@ -90,28 +235,43 @@ std::size_t smo::SimulatorBase::rejected_amount() const {
 smo::Time smo::SimulatorBase::current_simulation_time() const {
   return current_simulation_time_;
 }
-const std::vector<smo::SourceStatistics>&
+const std::pmr::vector<smo::SourceStatistics>&
 smo::SimulatorBase::source_statistics() const {
   return sources_;
 }
-const std::vector<smo::DeviceStatistics>&
+const std::pmr::vector<smo::DeviceStatistics>&
 smo::SimulatorBase::device_statistics() const {
   return devices_;
 }
+const std::pmr::vector<smo::DeviceClassStatistics>&
+smo::SimulatorBase::device_class_statistics() const {
+  return device_classes_;
+}
 
 void smo::SimulatorBase::HandleNewRequestCreation(std::size_t source_id) {
   auto& source = sources_[source_id];
-  Request request{
-      source_id,
-      source.generated,
-      current_simulation_time_,
-  };
-  source.generated += 1;
-  current_amount_of_requests_ += 1;
-  if (!OccupyNextDevice(request)) {
-    auto rejected_request = PutInBuffer(request);
-    if (rejected_request.has_value()) {
-      HandleBufferOverflow(*rejected_request);
+  // The last batch is cut to the target amount of requests.
+  std::size_t remaining_amount =
+      target_amount_of_requests_ > current_amount_of_requests_
+          ? target_amount_of_requests_ - current_amount_of_requests_
+          : 1;
+  auto batch_size = std::min(BatchSize(source_id), remaining_amount);
+  // Once devices are all busy, the rest of the batch goes to buffer.
+  bool has_free_devices = true;
+  for (std::size_t i = 0; i < batch_size; ++i) {
+    Request request{
+        source_id,
+        source.generated,
+        current_simulation_time_,
+    };
+    source.generated += 1;
+    current_amount_of_requests_ += 1;
+    has_free_devices = has_free_devices && OccupyNextDevice(request);
+    if (!has_free_devices) {
+      auto rejected_request = PutInBuffer(request);
+      if (rejected_request.has_value()) {
+        HandleBufferOverflow(*rejected_request);
+      }
     }
   }
 
@@ -120,15 +280,33 @@ void smo::SimulatorBase::HandleNewRequestCreation(std::size_t source_id) {
     for (auto& source : sources_) {
       source.next_request = maxTime;
     }
-  } else {
+  } else if (source_groups_.empty()) {
     AddSpecialEvent(SpecialEvent{
         SpecialEventKind::generateNewRequest,
         current_simulation_time_ + SourcePeriod(source_id),
         source_id,
     });
+  } else {
+    source.next_request = maxTime;
+    auto arrival = NextGroupArrival(source_groups_[source_id]);
+    AddSpecialEvent(SpecialEvent{
+        SpecialEventKind::generateNewRequest,
+        current_simulation_time_ + arrival.period,
+        arrival.source_id,
+    });
   }
 }
 
+std::size_t smo::SimulatorBase::BatchSize(std::size_t source_id) { return 1; }
+double smo::SimulatorBase::ProcessingTimeDerivative(std::size_t device_id,
+                                                    Time processing_time) {
+  return 0.0;
+}
+double smo::SimulatorBase::SourcePeriodScore(std::size_t source_id,
+                                             Time period) {
+  return 0.0;
+}
+
 void smo::SimulatorBase::HandleBufferOverflow(const smo::Request& request) {
   auto time = current_simulation_time_ - request.generation_time;
   auto& source = sources_[request.source_id];
@@ -137,24 +315,48 @@ void smo::SimulatorBase::HandleBufferOverflow(const smo::Request& request) {
   rejected_amount_ += 1;
 }
 
+void smo::SimulatorBase::AddWaitTime(const smo::Request& request) {
+  auto time = current_simulation_time_ - request.generation_time;
+  sources_[request.source_id].AddTimeInBuffer(time);
+  if (time > wait_threshold_) {
+    late_amount_ += 1;
+  }
+}
+
 void smo::SimulatorBase::HandleDeviceRelease(std::size_t device_id) {
   auto& device = devices_[device_id];
+  if (is_estimating_gradients_) {
+    sojourn_derivative_sums_[device_id] += release_derivatives_[device_id];
+  }
   device.current_request = std::nullopt;
+  OnDeviceRelease(device_id);
   auto request = TakeOutOfBuffer();
   if (request.has_value()) {
-    auto time = current_simulation_time_ - request->generation_time;
-    sources_[request->source_id].AddTimeInBuffer(time);
+    AddWaitTime(*request);
     OccupyNextDevice(*request);
   } else {
     device.next_request = maxTime;
+    if (is_estimating_gradients_) {
+      release_derivatives_[device_id] = 0.0;
+    }
   }
 }
+void smo::SimulatorBase::OnDeviceRelease(std::size_t device_id) {}
 bool smo::SimulatorBase::OccupyNextDevice(smo::Request request) {
+  if (!device_classes_.empty()) {
+    return OccupyDeviceClass(request);
+  }
   auto device_id = PickDevice();
   if (device_id.has_value()) {
     auto& device = devices_[*device_id];
     auto processing_time = DeviceProcessingTime(*device_id, request);
     sources_[request.source_id].AddTimeInDevice(processing_time);
+    if (is_estimating_gradients_) {
+      // Idle device starts at arrival, otherwise it continues its own busy
+      // period from the release.
+      release_derivatives_[*device_id] +=
+          ProcessingTimeDerivative(*device_id, processing_time);
+    }
     device.current_request = request;
     device.time_in_usage += processing_time;
     AddSpecialEvent(SpecialEvent{
@@ -167,7 +369,94 @@ bool smo::SimulatorBase::OccupyNextDevice(smo::Request request) {
     return false;
   }
 }
-void smo::SimulatorBase::AddSpecialEvent(smo::SpecialEvent event) {
+void smo::SimulatorBase::AggregateDevices(
+    std::span<const std::size_t> class_sizes) {
+  devices_.clear();
+  device_classes_.clear();
+  for (auto size : class_sizes) {
+    device_classes_.push_back(DeviceClassStatistics{.size = size});
+  }
+  served_requests_.assign(class_sizes.size(), {});
+  device_class_releases_.Reset(class_sizes.size());
+}
+smo::Time smo::SimulatorBase::DeviceClassPeriod(std::size_t class_id,
+                                                std::size_t busy) {
+  return maxTime;
+}
+std::size_t smo::SimulatorBase::PickServedRequest(std::size_t class_id,
+                                                  std::size_t amount) {
+  return 0;
+}
+void smo::SimulatorBase::GroupSources(
+    std::span<const std::size_t> source_groups) {
+  source_groups_.assign(source_groups.begin(), source_groups.end());
+  for (auto& source : sources_) {
+    source.next_request = maxTime;
+  }
+}
+smo::GroupArrival smo::SimulatorBase::NextGroupArrival(std::size_t group_id) {
+  return GroupArrival{maxTime, 0};
+}
+// Time in device is added on release here, since processing time is not
+// known in advance.
+void smo::SimulatorBase::HandleDeviceClassRelease(std::size_t class_id) {
+  auto& device_class = device_classes_[class_id];
+  auto& served = served_requests_[class_id];
+  auto index = PickServedRequest(class_id, served.size());
+  auto finished = served[index];
+  served[index] = served.back();
+  served.pop_back();
+  sources_[finished.request.source_id].AddTimeInDevice(
+      current_simulation_time_ - finished.start_time);
+  UpdateDeviceClassUsage(device_class);
+  device_class.busy -= 1;
+  ScheduleDeviceClassRelease(class_id);
+  auto request = TakeOutOfBuffer();
+  if (request.has_value()) {
+    AddWaitTime(*request);
+    OccupyDeviceClass(*request);
+  }
+}
+bool smo::SimulatorBase::OccupyDeviceClass(smo::Request request) {
+  auto class_id = PickDevice();
+  if (!class_id.has_value()) {
+    return false;
+  }
+  auto& device_class = device_classes_[*class_id];
+  assert(device_class.busy < device_class.size);
+  UpdateDeviceClassUsage(device_class);
+  device_class.busy += 1;
+  served_requests_[*class_id].push_back(
+      ServedRequest{request, current_simulation_time_});
+  ScheduleDeviceClassRelease(*class_id);
+  return true;
+}
+// Remaining processing times are memoryless, so the release is simply
+// drawn anew whenever the amount of busy devices changes.
+void smo::SimulatorBase::ScheduleDeviceClassRelease(std::size_t class_id) {
+  auto& device_class = device_classes_[class_id];
+  device_class.next_request =
+      device_class.busy == 0
+          ? maxTime
+          : current_simulation_time_ +
+                DeviceClassPeriod(class_id, device_class.busy);
+  if (device_class.next_request == maxTime) {
+    if (device_class_releases_.Contains(class_id)) {
+      device_class_releases_.Remove(class_id);
+    }
+  } else if (device_class_releases_.Contains(class_id)) {
+    device_class_releases_.Update(class_id, device_class.next_request);
+  } else {
+    device_class_releases_.Push(class_id, device_class.next_request);
+  }
+}
+void smo::SimulatorBase::UpdateDeviceClassUsage(
+    smo::DeviceClassStatistics& device_class) {
+  device_class.time_in_usage +=
+      device_class.busy * (current_simulation_time_ - device_class.last_change);
+  device_class.last_change = current_simulation_time_;
+}
+void smo::SimulatorBase::UpdateNextRequest(const smo::SpecialEvent& event) {
   switch (event.kind) {
     case SpecialEventKind::generateNewRequest:
       sources_[event.id].next_request = event.planned_time;
@@ -175,8 +464,35 @@ void smo::SimulatorBase::AddSpecialEvent(smo::SpecialEvent event) {
     case SpecialEventKind::deviceRelease:
       devices_[event.id].next_request = event.planned_time;
       break;
+    case SpecialEventKind::deviceClassRelease:
     case SpecialEventKind::endOfSimulation:
       break;
   }
+}
+void smo::SimulatorBase::AddSourcePeriodScore(const smo::SpecialEvent& event) {
+  if (event.kind != SpecialEventKind::generateNewRequest ||
+      !source_groups_.empty()) {
+    return;
+  }
+  double score = SourcePeriodScore(
+      event.id, event.planned_time - current_simulation_time_);
+  score_sums_[event.id] += score;
+  rejection_weighted_score_sums_[event.id] += score * rejected_amount_;
+}
+void smo::SimulatorBase::AddSpecialEvent(smo::SpecialEvent event) {
+  if (is_estimating_gradients_) {
+    AddSourcePeriodScore(event);
+  }
+  UpdateNextRequest(event);
   special_events_.push(event);
 }
+void smo::SimulatorBase::AddSpecialEvents(
+    std::span<const smo::SpecialEvent> events) {
+  for (const auto& event : events) {
+    if (is_estimating_gradients_) {
+      AddSourcePeriodScore(event);
+    }
+    UpdateNextRequest(event);
+  }
+  special_events_.push_range(events.data(), events.data() + events.size());
+}
@@ -5,34 +5,67 @@
 #include <cstdint>
 #include <functional>
 #include <iosfwd>
+#include <memory_resource>
 #include <optional>
 #include <queue>
+#include <span>
 #include <vector>
 
+#include "indexed_heap.h"
 #include "smo_components.h"
 
 namespace smo {
+class ProgressChannel;
 class SimulatorBase {
  public:
+  // Every container of the simulation state is allocated from `resource`,
+  // which must outlive the simulator.
   SimulatorBase(std::size_t sources_amount, std::size_t devices_amount,
-                std::size_t target_amount_of_requests);
+                std::size_t target_amount_of_requests,
+                std::pmr::memory_resource* resource =
+                    std::pmr::get_default_resource());
   virtual ~SimulatorBase() = default;
 
   SpecialEvent Step();
+  // Each of these returns the amount of processed events.
+  std::size_t StepN(std::size_t amount);
+  // Processes every event planned no later than `time`.
+  std::size_t StepUntil(Time time);
+  // Fills `events` with processed events, until it is full, or the next
+  // event is planned later than `time`.
+  std::size_t StepBatch(std::span<SpecialEvent> events, Time time = maxTime);
   void RunToCompletion();
   virtual void Reset();
   virtual void ResetWithNewAmountOfRequests(
       std::size_t target_amount_of_requests);
+  // Publishes progress to `channel` every `period` events and on completion.
+  // Pass nullptr to stop publishing. Channel must outlive the simulator.
+  void AttachProgressChannel(ProgressChannel* channel, std::size_t period);
+  // Needs the derivative hooks. Resets the simulation.
+  // Aggregated devices and grouped sources are left out of estimation.
+  void EnableGradientEstimation(bool is_enabled);
+  // Zeros, until a request is counted.
+  GradientEstimates gradient_estimates() const;
+  // Counts requests, which wait in buffer longer than `threshold` before
+  // their service starts. Defaults to maxTime, which counts none.
+  void SetWaitThreshold(Time threshold);
+  std::size_t late_amount() const;
   bool is_completed() const;
+  std::size_t processed_events() const;
   std::size_t current_amount_of_requests() const;
   std::size_t target_amount_of_requests() const;
   std::size_t rejected_amount() const;
   Time current_simulation_time() const;
-  const std::vector<SourceStatistics>& source_statistics() const;
-  const std::vector<DeviceStatistics>& device_statistics() const;
+  const std::pmr::vector<SourceStatistics>& source_statistics() const;
+  const std::pmr::vector<DeviceStatistics>& device_statistics() const;
+  // Empty unless devices are aggregated.
+  const std::pmr::vector<DeviceClassStatistics>& device_class_statistics()
+      const;
 
  protected:
   void AddSpecialEvent(SpecialEvent event);
+  // Same as adding events one by one, but takes linear time.
+  void AddSpecialEvents(std::span<const SpecialEvent> events);
 
   virtual std::optional<Request> PutInBuffer(Request request) = 0;
   virtual std::optional<Request> TakeOutOfBuffer() = 0;
@@ -40,21 +73,93 @@ class SimulatorBase {
   virtual Time DeviceProcessingTime(std::size_t device_id,
                                     const Request& request) = 0;
   virtual Time SourcePeriod(std::size_t source_id) = 0;
+  // Amount of requests, which the source makes at once. At least one.
+  virtual std::size_t BatchSize(std::size_t source_id);
+  // Gradient estimation only. Derivative of the processing time by the
+  // device coefficient.
+  virtual double ProcessingTimeDerivative(std::size_t device_id,
+                                          Time processing_time);
+  // Gradient estimation only. Derivative of the log density of the period
+  // by its mean, or zero for non random periods.
+  virtual double SourcePeriodScore(std::size_t source_id, Time period);
+  // Called when device becomes free, before the next request is picked
+  // from the buffer.
+  virtual void OnDeviceRelease(std::size_t device_id);
+
+  // Switches to aggregated mode, where device ids returned by PickDevice
+  // name classes of identical devices with exponential processing time.
+  // Each class holds a busy counter and a single release event instead of
+  // per device state. Must be called before any event is added.
+  void AggregateDevices(std::span<const std::size_t> class_sizes);
+  // Aggregated mode only. Time until the next release in class with `busy`
+  // processing devices: exponential with their rates summed.
+  virtual Time DeviceClassPeriod(std::size_t class_id, std::size_t busy);
+  // Aggregated mode only. Uniform random index in [0, amount) of the
+  // request, which is released. Memorylessness makes every one of them
+  // equally likely to finish first.
+  virtual std::size_t PickServedRequest(std::size_t class_id,
+                                        std::size_t amount);
+
+  // Merges arrivals of sources into streams, where `source_groups[i]` is
+  // the stream of source i. Each stream keeps a single pending event, which
+  // names the source of its next request. Must be called before any event is
+  // added, and initial events have to be added per stream.
+  void GroupSources(std::span<const std::size_t> source_groups);
+  // Grouped sources only. Replaces SourcePeriod.
+  virtual GroupArrival NextGroupArrival(std::size_t group_id);
 
  private:
+  struct ServedRequest {
+    Request request;
+    Time start_time;
+  };
   void HandleBufferOverflow(const Request& request);
+  void AddWaitTime(const Request& request);
   void HandleNewRequestCreation(std::size_t source_id);
   void HandleDeviceRelease(std::size_t device_id);
   bool OccupyNextDevice(Request request);
+  void HandleDeviceClassRelease(std::size_t class_id);
+  bool OccupyDeviceClass(Request request);
+  void ScheduleDeviceClassRelease(std::size_t class_id);
+  void UpdateDeviceClassUsage(DeviceClassStatistics& device_class);
+  bool IsDeviceClassReleaseNext() const;
+  SpecialEvent NextDeviceClassRelease() const;
   SpecialEvent UncheckedStep();
+  bool HasEventNoLaterThan(Time time) const;
+  void PublishProgress();
+  void UpdateNextRequest(const SpecialEvent& event);
+  void AddSourcePeriodScore(const SpecialEvent& event);
 
-  std::vector<SourceStatistics> sources_;
-  std::vector<DeviceStatistics> devices_;
+  std::pmr::vector<SourceStatistics> sources_;
+  std::pmr::vector<std::size_t> source_groups_;
+  std::pmr::vector<DeviceStatistics> devices_;
   special_event_queue special_events_;
+  std::pmr::vector<DeviceClassStatistics> device_classes_;
+  std::pmr::vector<std::pmr::vector<ServedRequest>> served_requests_;
+  // Pending releases of device classes, at most one per class, keyed by
+  // planned time.
+  IndexedHeap<Time> device_class_releases_;
   std::size_t current_amount_of_requests_{0};
   std::size_t target_amount_of_requests_{0};
   std::size_t rejected_amount_{0};
+  Time wait_threshold_{maxTime};
+  std::size_t late_amount_{0};
   Time current_simulation_time_{0};
+  std::size_t processed_events_{0};
+  ProgressChannel* progress_channel_{nullptr};
+  std::size_t progress_period_{0};
+  std::size_t events_until_progress_{0};
+  bool is_estimating_gradients_{false};
+  // Derivative of the planned release by the device coefficient. Requests
+  // wait in buffer only while all devices are busy, so a busy period
+  // depends only on coefficient of its device.
+  std::pmr::vector<double> release_derivatives_;
+  std::pmr::vector<double> sojourn_derivative_sums_;
+  // Score of every period drawn so far, and the same weighted by the amount
+  // of rejections before it was drawn. Rejections after the period is drawn
+  // are the ones it can influence.
+  std::pmr::vector<double> score_sums_;
+  std::pmr::vector<double> rejection_weighted_score_sums_;
 };
 }  // namespace smo
 #endif
@@ -28,6 +28,9 @@ void smo::SourceStatistics::AddTimeInDevice(smo::Time time) {
   time_in_device += time;
   time_squared_in_device += time * time;
 }
+double smo::DeviceClassStatistics::UsageCoefficient(Time total_time) const {
+  return static_cast<double>(time_in_usage) / (size * total_time);
+}
 bool smo::SpecialEventComparator::operator()(const SpecialEvent& lhs,
                                              const SpecialEvent& rhs) const {
   if (lhs.planned_time != rhs.planned_time) {
@@ -39,6 +42,12 @@ bool smo::SpecialEventComparator::operator()(const SpecialEvent& lhs,
   return lhs.id > rhs.id;
 }
 
+smo::special_event_queue::special_event_queue(
+    std::pmr::memory_resource* resource)
+    : std::priority_queue<SpecialEvent, std::pmr::vector<SpecialEvent>,
+                          SpecialEventComparator>(
+          SpecialEventComparator{}, std::pmr::vector<SpecialEvent>(resource)) {}
+
 void smo::special_event_queue::clear() { this->c.clear(); }
 
 void smo::special_event_queue::remove_excess_generations() {
@@ -49,3 +58,9 @@ void smo::special_event_queue::remove_excess_generations() {
   this->c.erase(new_end, c.end());
   std::make_heap(this->c.begin(), this->c.end(), this->comp);
 }
+
+void smo::special_event_queue::push_range(const SpecialEvent* first,
+                                          const SpecialEvent* last) {
+  this->c.insert(this->c.end(), first, last);
+  std::make_heap(this->c.begin(), this->c.end(), this->comp);
+}
@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <functional>
 #include <limits>
+#include <memory_resource>
 #include <optional>
 #include <queue>
 #include <string>
@@ -14,6 +15,8 @@
 namespace smo {
 using Time = std::uint64_t;
 constexpr Time maxTime = std::numeric_limits<Time>::max();
+// Changes whenever the same model and seed start giving different results.
+constexpr std::uint32_t libraryVersion = 1;
 struct SourceStatistics {
   double AverageBufferTime() const;
   double AverageDeviceTime() const;
@@ -40,10 +43,35 @@ struct DeviceStatistics {
   Time time_in_usage = 0;
   std::optional<Request> current_request;
 };
+// A group of identical devices, tracked by the amount of busy ones.
+struct DeviceClassStatistics {
+  double UsageCoefficient(Time total_time) const;
+
+  std::size_t size = 0;
+  std::size_t busy = 0;
+  Time next_request = maxTime;
+  // Summed over every device of the class.
+  Time time_in_usage = 0;
+  Time last_change = 0;
+};
+// Derivatives of results by model parameters, estimated during a single run.
+struct GradientEstimates {
+  // Perturbation analysis: d(mean time in system) / d(device coefficient).
+  // Ignores changes in rejections, so it's biased, when those are frequent.
+  std::vector<double> sojourn_by_device_coefficient;
+  // Likelihood ratio: d(rejection probability) / d(source period).
+  std::vector<double> rejection_by_source_period;
+};
+// Next request of a merged arrival stream.
+struct GroupArrival {
+  Time period;
+  std::size_t source_id;
+};
 enum class SpecialEventKind {
   endOfSimulation = 0,
   generateNewRequest = 1,
   deviceRelease = 2,
+  deviceClassRelease = 3,
 };
 struct SpecialEvent {
   SpecialEventKind kind;
@@ -56,11 +84,16 @@ struct SpecialEventComparator {
 // Breaking the Google naming scheme,
 // because it's an extension of std collection.
 class special_event_queue
-    : public std::priority_queue<SpecialEvent, std::vector<SpecialEvent>,
+    : public std::priority_queue<SpecialEvent, std::pmr::vector<SpecialEvent>,
                                  SpecialEventComparator> {
  public:
+  special_event_queue() = default;
+  explicit special_event_queue(std::pmr::memory_resource* resource);
+
   void clear();
   void remove_excess_generations();
+  // Linear time alternative to pushing events one by one.
+  void push_range(const SpecialEvent* first, const SpecialEvent* last);
 };
 }  // namespace smo
 
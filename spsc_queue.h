@@ -0,0 +1,74 @@
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+namespace smo {
+// Unbounded lock-free queue for exactly one producer and one consumer thread.
+// Values are stored in fixed-size blocks, so allocation happens once per
+// `blockSize` pushes.
+template <typename T>
+class SpscQueue {
+ public:
+  SpscQueue() : head_(new Block), tail_(head_) {}
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+  ~SpscQueue() {
+    while (head_ != nullptr) {
+      auto next = head_->next.load(std::memory_order_relaxed);
+      delete head_;
+      head_ = next;
+    }
+  }
+
+  // Producer side.
+  void Push(const T& value) {
+    auto written = tail_written_;
+    if (written == blockSize) {
+      auto block = new Block;
+      tail_->next.store(block, std::memory_order_release);
+      tail_ = block;
+      written = 0;
+    }
+    tail_->values[written] = value;
+    tail_written_ = written + 1;
+    tail_->written.store(written + 1, std::memory_order_release);
+  }
+
+  // Consumer side.
+  std::optional<T> Pop() {
+    if (head_read_ == blockSize) {
+      auto next = head_->next.load(std::memory_order_acquire);
+      if (next == nullptr) {
+        return std::nullopt;
+      }
+      delete head_;
+      head_ = next;
+      head_read_ = 0;
+    }
+    if (head_read_ == head_->written.load(std::memory_order_acquire)) {
+      return std::nullopt;
+    }
+    return head_->values[head_read_++];
+  }
+
+ private:
+  static constexpr std::size_t blockSize = 256;
+  struct Block {
+    std::array<T, blockSize> values;
+    std::atomic<std::size_t> written{0};
+    std::atomic<Block*> next{nullptr};
+  };
+
+  // Consumer state.
+  alignas(64) Block* head_;
+  std::size_t head_read_ = 0;
+  // Producer state.
+  alignas(64) Block* tail_;
+  std::size_t tail_written_ = 0;
+};
+}  // namespace smo
+#endif